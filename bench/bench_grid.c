@@ -0,0 +1,46 @@
+#include "bench_grid.h"
+#include "cell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+double benchSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+CellularAutomaton syntheticGrid(size_t size, int windX, int windY, WindSpeed speed) {
+    const VegType types[] = {VEG_BROADLEAVES, VEG_SHRUBS, VEG_GRASSLAND, VEG_FIREPRONE, VEG_AGROFORESTRY};
+
+    CellArray* rows = malloc(size * sizeof(CellArray));
+    Cell* cells = malloc(size * size * sizeof(Cell));
+    if (!rows || !cells) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    srand(1);
+    for (size_t row = 0; row < size; row++) {
+        rows[row] = (CellArray) {
+            .elements = cells + row * size,
+            .count = size,
+        };
+        for (size_t col = 0; col < size; col++) {
+            cells[row * size + col] = (Cell) {
+                .moisture = (float)(30 + rand() % 40) / 100.f,
+                .on_fire_counter = 0,
+                .type = types[(size_t)rand() % (sizeof(types) / sizeof(types[0]))],
+                .state = col % 64 == 0 ? CELLSTATE_ONFIRE : CELLSTATE_NORMAL,
+            };
+        }
+    }
+
+    return (CellularAutomaton) {
+        .rows = rows,
+        .num_rows = size,
+        .windX = windX,
+        .windY = windY,
+        .speed = speed,
+    };
+}
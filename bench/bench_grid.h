@@ -0,0 +1,9 @@
+#pragma once
+#include "cell.h"
+
+/// Grid of mixed vegetation and moisture with a line of fire every 64 columns,
+/// the same for every call. Destroy it with `destroyAutomaton`.
+CellularAutomaton syntheticGrid(size_t size, int windX, int windY, WindSpeed speed);
+
+/// Wall clock time in seconds
+double benchSeconds(void);
@@ -0,0 +1,59 @@
+// Scaling of the parallel step with and without NUMA placement.
+// Usage: wildfire-bench-numa [grid size] [steps] [max threads]
+// Runs the synthetic grid from bench_grid.c with 1, 2, 4, ... threads up to the number of CPUs.
+#include "bench_grid.h"
+#include "cell.h"
+#include "parallel_step.h"
+#include "topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static double secondsPerStep(const CellularAutomaton* initial, size_t threads, bool numa_aware, size_t steps) {
+    ParallelStepper* stepper = createParallelStepper(initial, threads, numa_aware, 42);
+
+    // The first steps fault in whatever the first touch didn't
+    runParallelSteps(stepper, 2);
+
+    const double start = benchSeconds();
+    runParallelSteps(stepper, steps);
+    const double elapsed = benchSeconds() - start;
+
+    destroyParallelStepper(stepper);
+    return elapsed / (double)steps;
+}
+
+int main(int argc, char const* const* argv) {
+    const size_t size = argc > 1 ? (size_t)strtoul(argv[1], nullptr, 10) : 4096;
+    const size_t steps = argc > 2 ? (size_t)strtoul(argv[2], nullptr, 10) : 20;
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t max_threads = argc > 3 ? (size_t)strtoul(argv[3], nullptr, 10) : (size_t)(online > 0 ? online : 1);
+
+    Topology topology = readTopology();
+    printf("%zux%zu grid, %zu steps, %zu NUMA node(s)\n", size, size, steps, topology.num_nodes);
+    destroyTopology(&topology);
+
+    CellularAutomaton initial = syntheticGrid(size, 1, 0, WIND_MODERATE);
+
+    double baseline = 0.0;
+    printf("threads   plain ms/step   numa ms/step   plain speedup   numa speedup\n");
+    // Doubling the threads, but always ending on the maximum
+    for (size_t threads = 1;; threads *= 2) {
+        if (threads > max_threads)
+            threads = max_threads;
+
+        const double plain = secondsPerStep(&initial, threads, false, steps);
+        const double numa = secondsPerStep(&initial, threads, true, steps);
+        if (threads == 1)
+            baseline = plain;
+
+        printf("%7zu   %13.3f   %12.3f   %13.2fx   %12.2fx\n",
+               threads, plain * 1e3, numa * 1e3, baseline / plain, baseline / numa);
+
+        if (threads == max_threads)
+            break;
+    }
+
+    destroyAutomaton(&initial);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// Many short scenarios on one grid, loading the grid for every scenario against resetting a context.
+// Usage: wildfire-bench-scenarios [grid.cellgrid] [scenarios] [steps]
+// Without a grid (or with "-") the 512x512 synthetic grid from bench_grid.c is used.
+#include "bench_grid.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "input.h"
+#include "random.h"
+#include "simulation.h"
+#include "terrain.h"
+#include "wildfire.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static CellularAutomaton loadGrid(const char* path) {
+    return path ? readInitialState(path) : syntheticGrid(512, 1, 0, WIND_MODERATE);
+}
+
+static size_t countBurnt(const Cell* cells, size_t num_cells) {
+    size_t burnt = 0;
+    for (size_t index = 0; index < num_cells; index++)
+        burnt += cells[index].state == CELLSTATE_BURNT;
+    return burnt;
+}
+
+/// Scenario `index` ignites a cell in the middle with one of the 8 wind directions
+static void scenarioWind(size_t index, int* windX, int* windY) {
+    static const int directions[8][2] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+    *windX = directions[index % 8][0];
+    *windY = directions[index % 8][1];
+}
+
+// What the scheduler did before the library, everything from scratch for every scenario
+static size_t runReloading(const char* path, size_t scenarios, size_t steps) {
+    size_t burnt = 0;
+    for (size_t index = 0; index < scenarios; index++) {
+        CellularAutomaton automaton = loadGrid(path);
+        scenarioWind(index, &automaton.windX, &automaton.windY);
+        Cell* cell = &automaton.rows[automaton.num_rows / 2].elements[automaton.rows[0].count / 2];
+        if (cell->state == CELLSTATE_NORMAL)
+            cell->state = CELLSTATE_ONFIRE;
+
+        BurnoutWheel wheel = createBurnoutWheel(&automaton);
+        automaton.burnout = &wheel;
+        seedSimulation(index);
+        for (size_t step = 0; step < steps;) {
+            step += skipIdleSteps(&automaton, steps - step);
+            if (step >= steps)
+                break;
+            stepAutomaton(&automaton);
+            step++;
+        }
+
+        burnt += countBurnt(automaton.rows[0].elements, automaton.num_rows * automaton.rows[0].count);
+        destroyBurnoutWheel(&wheel);
+        destroyTerrain(automaton.terrain);
+        destroyAutomaton(&automaton);
+    }
+    return burnt;
+}
+
+static size_t runContext(WildfireContext* context, size_t scenarios, size_t steps) {
+    size_t burnt = 0;
+    for (size_t index = 0; index < scenarios; index++) {
+        const WildfireView loaded = wildfireState(context);
+        int windX, windY;
+        scenarioWind(index, &windX, &windY);
+
+        wildfireReset(context);
+        wildfireSetWind(context, windX, windY, wildfireAutomaton(context)->speed);
+        wildfireIgnite(context, loaded.num_rows / 2, loaded.num_columns / 2);
+        seedSimulation(index);
+        wildfireStep(context, steps);
+
+        const WildfireView view = wildfireState(context);
+        burnt += countBurnt(view.cells, view.num_rows * view.num_columns);
+    }
+    return burnt;
+}
+
+int main(int argc, char const* const* argv) {
+    const char* path = argc > 1 && strcmp(argv[1], "-") != 0 ? argv[1] : nullptr;
+    const size_t scenarios = argc > 2 ? (size_t)strtoul(argv[2], nullptr, 10) : 200;
+    const size_t steps = argc > 3 ? (size_t)strtoul(argv[3], nullptr, 10) : 20;
+
+    double start = benchSeconds();
+    const size_t reloading_burnt = runReloading(path, scenarios, steps);
+    const double reloading = benchSeconds() - start;
+
+    CellularAutomaton automaton = loadGrid(path);
+    if (automaton.num_rows == 0)
+        return EXIT_FAILURE;
+    WildfireContext* context = wildfireCreateFromAutomaton(&automaton);
+    if (!context)
+        return EXIT_FAILURE;
+
+    start = benchSeconds();
+    const size_t context_burnt = runContext(context, scenarios, steps);
+    const double reusing = benchSeconds() - start;
+    wildfireDestroy(context);
+
+    printf("%zu scenarios of %zu steps\n", scenarios, steps);
+    printf("reloading: %8.3f ms/scenario, %zu cells burnt\n", reloading * 1e3 / (double)scenarios, reloading_burnt);
+    printf("context:   %8.3f ms/scenario, %zu cells burnt\n", reusing * 1e3 / (double)scenarios, context_burnt);
+    return EXIT_SUCCESS;
+}
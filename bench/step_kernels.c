@@ -0,0 +1,103 @@
+// Benchmark of the wind specialized step kernels against the generic ones.
+// Usage: wildfire-bench-kernels [grid.cellgrid] [steps]
+// Without a grid (or with "-") the 1024x1024 synthetic grid from bench_grid.c is used.
+#include "bench_grid.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "direct_spread.h"
+#include "input.h"
+#include "random.h"
+#include "spotting_spread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef CellularAutomaton (*PhaseFn)(const CellularAutomaton* automaton);
+
+static void applyPhase(CellularAutomaton* automaton, PhaseFn phase) {
+    CellularAutomaton new = phase(automaton);
+    destroyAutomaton(automaton);
+    *automaton = new;
+}
+
+/// Runs the steps from the initial state with a fixed seed, returns the seconds per step
+static double run(const CellularAutomaton* initial, size_t steps, PhaseFn direct, PhaseFn spotting, CellularAutomaton* out) {
+    CellularAutomaton automaton = cloneAutomaton(initial);
+    BurnoutWheel wheel = createBurnoutWheel(&automaton);
+    automaton.burnout = &wheel;
+
+    seedSimulation(42);
+    const double start = benchSeconds();
+    for (size_t step = 0; step < steps; step++) {
+        applyPhase(&automaton, direct);
+        applyPhase(&automaton, spotting);
+        applyPhase(&automaton, burnoutCells);
+    }
+    const double elapsed = benchSeconds() - start;
+
+    destroyBurnoutWheel(&wheel);
+    automaton.burnout = nullptr;
+    *out = automaton;
+    return elapsed / (double)steps;
+}
+
+// Baseline for the cost every phase pays to copy the grid, regardless of the kernel
+static CellularAutomaton copyOnly(const CellularAutomaton* automaton) {
+    return cloneAutomaton(automaton);
+}
+
+static bool sameStates(const CellularAutomaton* a, const CellularAutomaton* b) {
+    for (size_t row = 0; row < a->num_rows; row++) {
+        for (size_t col = 0; col < a->rows[row].count; col++) {
+            if (a->rows[row].elements[col].state != b->rows[row].elements[col].state)
+                return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char const* const* argv) {
+    const size_t steps = argc > 2 ? (size_t)strtoul(argv[2], nullptr, 10) : 100;
+
+    // A few wind configurations, the calm one has no spotting reach at all
+    const struct { int windX; int windY; WindSpeed speed; } winds[] = {
+        {0, 0, WIND_NONE},
+        {1, 0, WIND_MODERATE},
+        {-1, -1, WIND_EXTREME},
+    };
+
+    for (size_t i = 0; i < sizeof(winds) / sizeof(winds[0]); i++) {
+        CellularAutomaton initial;
+        if (argc > 1 && strcmp(argv[1], "-") != 0) {
+            initial = readInitialState(argv[1]);
+            if (initial.num_rows == 0)
+                return EXIT_FAILURE;
+        } else {
+            initial = syntheticGrid(1024, 0, 0, WIND_NONE);
+        }
+        initial.windX = winds[i].windX;
+        initial.windY = winds[i].windY;
+        initial.speed = winds[i].speed;
+
+        CellularAutomaton generic_result;
+        CellularAutomaton specialized_result;
+        const double generic = run(&initial, steps, directSpreadGeneric, spottingSpreadGeneric, &generic_result);
+        const double specialized = run(&initial, steps, directSpread, spottingSpread, &specialized_result);
+
+        CellularAutomaton copy_result;
+        const double copy = run(&initial, steps, copyOnly, copyOnly, &copy_result);
+
+        printf("wind (%2d,%2d) speed %d: generic %8.3f ms/step, specialized %8.3f ms/step, %.2fx (%.2fx without the %.3f ms of copying), %s\n",
+               winds[i].windX, winds[i].windY, (int)winds[i].speed,
+               generic * 1e3, specialized * 1e3, generic / specialized,
+               (generic - copy) / (specialized - copy), copy * 1e3,
+               sameStates(&generic_result, &specialized_result) ? "identical" : "DIFFERENT");
+
+        destroyAutomaton(&copy_result);
+        destroyAutomaton(&generic_result);
+        destroyAutomaton(&specialized_result);
+        destroyAutomaton(&initial);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -24,6 +24,7 @@
           (python3.withPackages (p: [
             p.customtkinter
             p.tkinter
+            p.numpy
           ]))
           llvmPackages_latest.lldb
 
@@ -1,24 +1,19 @@
 #!/usr/bin/env python3
 from enum import Enum
-from io import BufferedReader
-from typing import Callable, TypeVar, final, TYPE_CHECKING, override
+from typing import Callable, final
+import tkinter
 import customtkinter as tk
+import numpy as np
+import numpy.typing as npt
 from spinbox import Spinbox
 
 from sys import argv, stdout, stderr
 
-if TYPE_CHECKING:
-    from _typeshed import SupportsRichComparisonT
-else:
-    SupportsRichComparisonT = TypeVar("SupportsRichComparisonT")
-
 
 screen_scale = 100
 screen_width = 16 * screen_scale
 screen_height = 9 * screen_scale
 
-shift_held: bool = False
-
 
 class ViewMode(Enum):
     STATE = 0,
@@ -32,22 +27,6 @@ viewmode: ViewMode = ViewMode.STATE
 def iota(end: int) -> list[int]:
     return list(range(end))
 
-def on_press_key(event) -> None:
-    global shift_held
-    if event.keycode == 50 or event.keycode == 943782142:
-        shift_held = True
-
-
-def on_release_key(event) -> None:
-    global shift_held
-    if event.keycode == 50 or event.keycode == 939587838:
-        shift_held = False
-
-
-def clamp(val: SupportsRichComparisonT, min_val: SupportsRichComparisonT, max_val: SupportsRichComparisonT) -> SupportsRichComparisonT:
-    return max(min_val, min(val, max_val))
-
-
 
 class VegType(Enum):
     BROADLEAVES = 'B',
@@ -60,14 +39,8 @@ class VegType(Enum):
     def get(self) -> str:
         return str(self.value[0])
 
-
-def veg_type_from_str(input: str) -> VegType:
-    for type in VegType:
-        if input == type.get():
-            return type
-
-    _ = stderr.write(f"Invalid VegType string: {input}")
-    exit(1)
+    def code(self) -> int:
+        return ord(self.get())
 
 
 class CellState(Enum):
@@ -78,254 +51,458 @@ class CellState(Enum):
     def get(self) -> str:
         return str(self.value[0])
 
+    def code(self) -> int:
+        return ord(self.get())
+
 
-def cell_state_from_str(input: str) -> CellState:
-    for state in CellState:
-        if input == state.get():
-            return state
+Plane = npt.NDArray[np.uint8]
+Selection = tuple[slice, slice]
 
-    _ = stderr.write(f"Invalid CellState string: {input}")
+
+@final
+class CellGrid:
+    """
+    The cells as one array per field, so loading, painting, exporting and drawing are whole array
+    operations instead of a python loop per cell.
+    The state and type planes hold the characters of the file, like the C enums do.
+    """
+    def __init__(self, rows: int, cols: int) -> None:
+        self.state: Plane = np.full((rows, cols), CellState.NORMAL.code(), dtype=np.uint8)
+        self.type: Plane = np.full((rows, cols), VegType.NOTFIREPRONE.code(), dtype=np.uint8)
+        self.moisture: Plane = np.full((rows, cols), 80, dtype=np.uint8)
+        # Only kept to write them back on export, the editor doesn't change them
+        self.header: bytes | None = None
+        self.elevation: npt.NDArray[np.int64] | None = None
+
+    @property
+    def rows(self) -> int:
+        return self.state.shape[0]
+
+    @property
+    def cols(self) -> int:
+        return self.state.shape[1]
+
+
+def parse_numbers(buf: Plane, begin: npt.NDArray[np.int64], end: npt.NDArray[np.int64]) -> npt.NDArray[np.int64]:
+    """Parses the decimal numbers buf[begin[i]:end[i]] all at once, one digit position at a time"""
+    negative = buf[np.minimum(begin, len(buf) - 1)] == ord("-")
+    begin = begin + negative
+    digits = end - begin
+
+    value = np.zeros(len(begin), dtype=np.int64)
+    for k in range(int(digits.max(initial=0))):
+        has_digit = digits > k
+        digit = buf[np.where(has_digit, begin + k, 0)].astype(np.int64) - ord("0")
+        value = np.where(has_digit, value * 10 + digit, value)
+
+    return np.where(negative, -value, value)
+
+
+def fail(message: str) -> None:
+    _ = stderr.write(message + "\n")
     exit(1)
 
 
+def load_cellgrid(data: bytes, size: tuple[int, int]) -> CellGrid:
+    """
+    Reads the cells of a .cellgrid, one `state,type,moisture,[elevation,]` line per cell.
+    A file with the header line takes its size from it, otherwise `size` is (rows, cols).
+    """
+    header: bytes | None = None
+    if data[:1].isdigit() or data[:1] == b"-":
+        end = data.index(b"\n") + 1
+        header, data = data[:end], data[end:]
+        fields = header.split(b",")
+        # The header holds width,height,windX,windY,speed,[cell_size,]
+        size = (int(fields[1]), int(fields[0]))
+
+    rows, cols = size
+    count = rows * cols
+    grid = CellGrid(rows, cols)
+    grid.header = header
+    if count == 0:
+        return grid
+
+    buf: Plane = np.frombuffer(data, dtype=np.uint8)
+    ends = np.flatnonzero(buf == ord("\n"))
+    if len(buf) > 0 and buf[-1] != ord("\n"):
+        ends = np.append(ends, len(buf))
+    starts = np.concatenate(([0], ends[:-1] + 1))
+    # Skip blank lines, the shortest cell line is "N,N,0,"
+    keep = ends - starts >= 6
+    starts, ends = starts[keep], ends[keep]
+    if len(starts) < count:
+        fail(f"Expected {count} cells, the file has {len(starts)}")
+    starts = starts[:count]
+
+    commas = np.flatnonzero(buf == ord(","))
+    commas = np.append(commas, len(buf))
+    moisture_end = commas[np.searchsorted(commas, starts + 4)]
+    moisture = parse_numbers(buf, starts + 4, moisture_end)
+
+    state = buf[starts]
+    type = buf[starts + 2]
+    if not np.isin(state, [s.code() for s in CellState]).all():
+        fail(f"Invalid CellState string: {chr(state[~np.isin(state, [s.code() for s in CellState])][0])}")
+    if not np.isin(type, [t.code() for t in VegType]).all():
+        fail(f"Invalid VegType string: {chr(type[~np.isin(type, [t.code() for t in VegType])][0])}")
+    if ((moisture < 0) | (moisture > 100)).any():
+        fail("Invalid moisture, expected a percent")
+
+    grid.state = state.reshape(rows, cols).copy()
+    grid.type = type.reshape(rows, cols).copy()
+    grid.moisture = moisture.astype(np.uint8).reshape(rows, cols)
+
+    if header is not None and len(header.split(b",")) > 6:
+        elevation_end = commas[np.searchsorted(commas, moisture_end + 1)]
+        grid.elevation = parse_numbers(buf, moisture_end + 1, elevation_end).reshape(rows, cols)
+
+    return grid
+
+
+def write_digits(out: Plane, column: int, values: npt.NDArray[np.int64], width: int) -> None:
+    for k in range(width):
+        out[:, column + width - 1 - k] = ord("0") + values // 10**k % 10
+
+
+def export_cellgrid(grid: CellGrid) -> bytes:
+    """
+    Writes every cell as a fixed width line ("N,G,065," or "N,G,065,-000394,"), zero padded numbers
+    read like any other, so the whole file is one (cells, line length) array of characters.
+    """
+    count = grid.rows * grid.cols
+    length = 9 if grid.elevation is None else 17
+    out: Plane = np.empty((count, length), dtype=np.uint8)
+
+    out[:, 0] = grid.state.ravel()
+    out[:, 1] = ord(",")
+    out[:, 2] = grid.type.ravel()
+    out[:, 3] = ord(",")
+    write_digits(out, 4, grid.moisture.ravel().astype(np.int64), 3)
+    out[:, 7] = ord(",")
+    if grid.elevation is not None:
+        elevation = grid.elevation.ravel()
+        out[:, 8] = np.where(elevation < 0, ord("-"), ord("0"))
+        write_digits(out, 9, np.minimum(np.abs(elevation), 999999), 6)
+        out[:, 15] = ord(",")
+    out[:, -1] = ord("\n")
+
+    return (grid.header or b"") + out.tobytes()
+
+
+def colour_table(widget: tkinter.Misc, colours: dict[int, str]) -> Plane:
+    table: Plane = np.zeros((256, 3), dtype=np.uint8)
+    for code, name in colours.items():
+        r, g, b = widget.winfo_rgb(name)
+        table[code] = (r >> 8, g >> 8, b >> 8)
+    return table
+
+
+STATE_COLOURS: dict[int, str] = {
+    CellState.NORMAL.code(): "green",
+    CellState.ONFIRE.code(): "red",
+    CellState.BURNTOUT.code(): "black",
+}
+
+TYPE_COLOURS: dict[int, str] = {
+    VegType.BROADLEAVES.code(): "blue",
+    VegType.SHRUBS.code(): "dark green",
+    VegType.GRASSLAND.code(): "light green",
+    VegType.FIREPRONE.code(): "red",
+    VegType.AGROFORESTRY.code(): "yellow",
+    VegType.NOTFIREPRONE.code(): "grey",
+}
+
+
+def moisture_table() -> Plane:
+    # "#1111" followed by the moisture in hex
+    table: Plane = np.zeros((256, 3), dtype=np.uint8)
+    table[:, 0] = 0x11
+    table[:, 1] = 0x11
+    table[:, 2] = np.arange(256)
+    return table
+
+
+BACKGROUND = (0x2b, 0x2b, 0x2b)
+
+
 @final
-class Cell(tk.CTkButton):
-    def __init__(self, cellgrid,
-                 x: int,
-                 y: int,
-                 command: Callable[[int, int], None]):
-        width = int(cellgrid.winfo_reqwidth() / cellgrid.size[0])
-        height = int(cellgrid.winfo_reqheight() / cellgrid.size[1])
+class Viewport:
+    """Which part of the grid is on screen: the cell at the top left pixel and how many cells a pixel covers"""
+    def __init__(self, row: float, col: float, cells_per_pixel: float) -> None:
+        self.row = row
+        self.col = col
+        self.cells_per_pixel = cells_per_pixel
 
-        min_len = min(width, height)
+    def cell_at(self, x: float, y: float) -> tuple[float, float]:
+        return (self.row + y * self.cells_per_pixel, self.col + x * self.cells_per_pixel)
 
-        self.x = x
-        self.y = y
-        self.command = command
+    def pixel_at(self, row: float, col: float) -> tuple[float, float]:
+        return ((col - self.col) / self.cells_per_pixel, (row - self.row) / self.cells_per_pixel)
 
-        super().__init__(
-            cellgrid,
-            text="",
-            border_width=1,
-            border_color="black",
-            width=min_len,
-            height=min_len,
-            corner_radius=0,
-            command=self.callback
-        )
 
-        self.type: VegType = VegType.NOTFIREPRONE
-        self.state: CellState = CellState.NORMAL
-        self.moisture: int = 80
+def render(plane: Plane, table: Plane, view: Viewport, width: int, height: int) -> bytes:
+    """
+    Draws the grid as a binary PPM of width x height pixels by sampling one cell per pixel, so the
+    cost follows the size of the canvas and not the size of the grid.
+    Once the cells are 4 pixels wide or more, the first pixel row and column of each cell is drawn
+    black, as the cell borders.
+    """
+    rows, cols = plane.shape
+    cell_rows = np.floor(view.row + (np.arange(height) + 0.5) * view.cells_per_pixel).astype(np.int64)
+    cell_cols = np.floor(view.col + (np.arange(width) + 0.5) * view.cells_per_pixel).astype(np.int64)
+    row_inside = (cell_rows >= 0) & (cell_rows < rows)
+    col_inside = (cell_cols >= 0) & (cell_cols < cols)
 
-    def callback(self) -> None:
-        self.command(self.x, self.y)
+    rgb = table[plane[np.ix_(np.clip(cell_rows, 0, rows - 1), np.clip(cell_cols, 0, cols - 1))]]
 
+    if view.cells_per_pixel <= 0.25:
+        row_border = np.diff(cell_rows, prepend=cell_rows[0] - 1) != 0
+        col_border = np.diff(cell_cols, prepend=cell_cols[0] - 1) != 0
+        rgb[row_border, :] = 0
+        rgb[:, col_border] = 0
 
-    def select(self) -> None:
-        self.configure(border_color="yellow", border_width=2)
-        self.update_cell()
+    rgb[~row_inside, :] = BACKGROUND
+    rgb[:, ~col_inside] = BACKGROUND
 
-    def unselect(self) -> None:
-        self.configure(border_color="black", border_width=1)
-        self.update_cell()
+    return f"P6 {width} {height} 255\n".encode() + rgb.tobytes()
 
 
-    @override
-    def __str__(self) -> str:
-        return f"""
-            {{
-                .state = {self.state}
-                .type = {self.type}
-                .moisture = {self.moisture}
-            }}
-        """
+@final
+class CellGridFrame(tk.CTkFrame):
+    """
+    The grid drawn as one image on a canvas. The mouse wheel zooms around the pointer, the middle
+    button drags the view around. Clicking selects a cell, shift clicking or dragging selects the
+    rectangle between it and the first selected cell. With the brush on, dragging paints instead.
+    """
+    def __init__(self, master,
+                 grid: CellGrid,
+                 command: Callable[["CellGridFrame"], None]) -> None:
+        width: int = int(master.winfo_width() * 0.85)
+        height: int = int(master.winfo_height() * 0.85)
 
+        min_len = min(width, height)
+        super().__init__(master, width=min_len, height=min_len)
 
-    def update_cell(self) -> None:
-        col = None
-        match viewmode:
-            case ViewMode.STATE:
-                match self.state:
-                    case CellState.NORMAL:
-                        col = "green"
-                    case CellState.ONFIRE:
-                        col = "red"
-                    case CellState.BURNTOUT:
-                        col = "black"
+        self.cells = grid
+        self.command = command
+        self.size_px = min_len
 
-            case ViewMode.TYPE:
-                match self.type:
-                    case VegType.BROADLEAVES:
-                        col = "blue"
+        self.canvas = tk.CTkCanvas(self, width=min_len, height=min_len, highlightthickness=0, background="#2b2b2b")
+        self.canvas.grid(row=0, column=0)
+        self.image = tkinter.PhotoImage(master=self.canvas, width=min_len, height=min_len)
+        self.image_item = self.canvas.create_image(0, 0, anchor="nw", image=self.image)
+        self.selection_item = self.canvas.create_rectangle(0, 0, 0, 0, outline="yellow", width=2, state="hidden")
+
+        self.tables: dict[ViewMode, Plane] = {
+            ViewMode.STATE: colour_table(self, STATE_COLOURS),
+            ViewMode.TYPE: colour_table(self, TYPE_COLOURS),
+            ViewMode.MOISTURE: moisture_table(),
+        }
+
+        # Fit the whole grid
+        self.view = Viewport(0, 0, max(grid.rows, grid.cols) / min_len)
+
+        # Inclusive (row, col) corners, the first one is where the selection started
+        self.anchor: tuple[int, int] | None = None
+        self.corner: tuple[int, int] | None = None
 
-                    case VegType.SHRUBS:
-                        col = "dark green"
+        self.brush_on: bool = False
+        self.brush_radius: int = 0
+        self.paint: Callable[[Selection, npt.NDArray[np.bool_]], None] | None = None
 
-                    case VegType.GRASSLAND:
-                        col = "light green"
+        self.pan_from: tuple[int, int, Viewport] | None = None
 
-                    case VegType.FIREPRONE:
-                        col = "red"
+        _ = self.canvas.bind("<Button-1>", self.on_click)
+        _ = self.canvas.bind("<B1-Motion>", self.on_drag)
+        _ = self.canvas.bind("<Button-2>", self.on_pan_start)
+        _ = self.canvas.bind("<B2-Motion>", self.on_pan)
+        _ = self.canvas.bind("<MouseWheel>", lambda event: self.zoom(event.x, event.y, event.delta > 0))
+        _ = self.canvas.bind("<Button-4>", lambda event: self.zoom(event.x, event.y, True))
+        _ = self.canvas.bind("<Button-5>", lambda event: self.zoom(event.x, event.y, False))
 
-                    case VegType.AGROFORESTRY:
-                        col = "yellow"
+        self.redraw()
 
-                    case VegType.NOTFIREPRONE:
-                        col = "grey"
 
+    def redraw(self) -> None:
+        ppm = render(self.plane(), self.tables[viewmode], self.view, self.size_px, self.size_px)
+        self.image = tkinter.PhotoImage(master=self.canvas, data=ppm, format="PPM")
+        _ = self.canvas.itemconfigure(self.image_item, image=self.image)
+        self.draw_selection()
+
+
+    def plane(self) -> Plane:
+        match viewmode:
+            case ViewMode.STATE:
+                return self.cells.state
+            case ViewMode.TYPE:
+                return self.cells.type
             case ViewMode.MOISTURE:
-                moist_hex = f"{self.moisture:x}"
-                while len(moist_hex) < 2:
-                    moist_hex = "0" + moist_hex
+                return self.cells.moisture
 
-                col = f"#1111" + moist_hex
 
-        self.configure(fg_color=col)
+    def draw_selection(self) -> None:
+        selection = self.selection()
+        if selection is None:
+            _ = self.canvas.itemconfigure(self.selection_item, state="hidden")
+            return
 
-    def set_type(self, type: VegType) -> None:
-        self.type = type
+        rows, cols = selection
+        x0, y0 = self.view.pixel_at(rows.start, cols.start)
+        x1, y1 = self.view.pixel_at(rows.stop, cols.stop)
+        self.canvas.coords(self.selection_item, x0, y0, x1, y1)
+        _ = self.canvas.itemconfigure(self.selection_item, state="normal")
 
-    def set_state(self, state: CellState) -> None:
-        self.state = state
 
-    def set_moisture(self, moist: int) -> None:
-        self.moisture = clamp(moist, 0, 100)
+    def cell_at(self, x: int, y: int) -> tuple[int, int] | None:
+        row, col = self.view.cell_at(x, y)
+        row, col = int(np.floor(row)), int(np.floor(col))
+        if row < 0 or col < 0 or row >= self.cells.rows or col >= self.cells.cols:
+            return None
+        return (row, col)
 
 
-    def serialize(self) -> str:
-        out: str = ""
-        out += self.state.get() + ","
-        out += self.type.get() + ","
-        out += str(self.moisture) + ","
+    def on_click(self, event: tkinter.Event) -> None:
+        cell = self.cell_at(event.x, event.y)
+        if cell is None:
+            return
 
-        return out
+        if self.brush_on:
+            self.paint_at(cell)
+        # Shift is bit 0 of the modifier state on every platform
+        elif int(event.state) & 0x1 and self.anchor is not None:
+            self.select_multiple(cell)
+        else:
+            self.select_single(cell)
 
-    def update_from_serialized(self, serialized: bytes) -> None:
-        data = serialized.split(b",")
-        
-        self.state = cell_state_from_str(data[0].decode())
-        self.type = veg_type_from_str(data[1].decode())
-        self.moisture = int(data[2])
 
+    def on_drag(self, event: tkinter.Event) -> None:
+        cell = self.cell_at(event.x, event.y)
+        if cell is None:
+            return
 
-@final
-class CellGridFrame(tk.CTkFrame):
-    def __init__(self, master,
-                 gridsize: tuple[int, int],
-                 command: Callable[[list[Cell]], None],
-                 in_file: BufferedReader | None) -> None:
-        width: int = int(master.winfo_width() * 0.85)
-        height: int = int(master.winfo_height() * 0.85)
+        if self.brush_on:
+            self.paint_at(cell)
+        elif self.anchor is not None and cell != self.corner:
+            self.select_multiple(cell)
 
-        min_len = min(width, height)
-        super().__init__(master, width=min_len, height=min_len)
 
-        self.size: tuple[int, int] = gridsize
-        self.command = command
+    def on_pan_start(self, event: tkinter.Event) -> None:
+        self.pan_from = (event.x, event.y, Viewport(self.view.row, self.view.col, self.view.cells_per_pixel))
 
-        _ = self.grid_columnconfigure(iota(gridsize[0]), weight=1)
-        _ = self.grid_rowconfigure(iota(gridsize[1]), weight=1)
 
-        self.cells: list[list[Cell]] = []
-        self.selected: list[Cell] = []
+    def on_pan(self, event: tkinter.Event) -> None:
+        if self.pan_from is None:
+            return
 
-        self.update()
-        for row_num in range(gridsize[0]):
-            self.cells.append([])
-            row = self.cells[row_num]
-            for col_num in range(gridsize[1]):
-                row.append(self.make_cell(row_num, col_num, in_file))
-                row[col_num].update_cell()
+        x, y, start = self.pan_from
+        self.view.row = start.row - (event.y - y) * start.cells_per_pixel
+        self.view.col = start.col - (event.x - x) * start.cells_per_pixel
+        self.redraw()
 
 
-    def make_cell(self, x: int, y: int, reader: BufferedReader | None):
-        cell = Cell(self, x, y, self.select_button)
-        cell.grid(row=x, column=y)
+    def zoom(self, x: int, y: int, zoom_in: bool) -> None:
+        # Keep the cell under the pointer under the pointer
+        row, col = self.view.cell_at(x, y)
+        scale = 0.8 if zoom_in else 1.25
+        fit = max(self.cells.rows, self.cells.cols) / self.size_px
+        self.view.cells_per_pixel = float(np.clip(self.view.cells_per_pixel * scale, 1 / 64, max(fit, 1 / 64) * 2))
+        self.view.row = row - y * self.view.cells_per_pixel
+        self.view.col = col - x * self.view.cells_per_pixel
+        self.redraw()
 
-        if reader is not None:
-            cell.update_from_serialized(reader.readline())
 
-        return cell
+    def select_single(self, cell: tuple[int, int]) -> None:
+        self.anchor = cell
+        self.corner = cell
+        self.draw_selection()
+        self.command(self)
 
 
-    def select_button(self, x: int, y: int) -> None:
-        global shift_held
-        if shift_held:
-            self.select_multiple(x, y)
+    def select_multiple(self, cell: tuple[int, int]) -> None:
+        self.corner = cell
+        self.draw_selection()
+        self.command(self)
 
-        else:
-            self.select_single(x, y)
 
-        
-        # deduplicate, keeping order
-        unique: set[Cell] = set([])
-        new_list: list[Cell] = []
-        for cell in self.selected:
-            if cell not in unique:
-                new_list.append(cell)
+    def reset_selected(self) -> None:
+        self.anchor = None
+        self.corner = None
+        self.draw_selection()
+
 
-        self.selected = new_list
+    def selection(self) -> Selection | None:
+        if self.anchor is None or self.corner is None:
+            return None
 
-        self.command(self.selected)
+        (r0, c0), (r1, c1) = self.anchor, self.corner
+        return (slice(min(r0, r1), max(r0, r1) + 1), slice(min(c0, c1), max(c0, c1) + 1))
 
 
-    def select_single(self, x: int, y: int) -> None:
-        self.reset_selected()
+    def selected_count(self) -> int:
+        selection = self.selection()
+        if selection is None:
+            return 0
+        rows, cols = selection
+        return (rows.stop - rows.start) * (cols.stop - cols.start)
 
-        cell = self.cells[x][y]
-        cell.select()
 
-        self.selected.append(cell)
+    def multi_select(self) -> bool:
+        return self.selected_count() > 1
 
 
-    def select_multiple(self, x: int, y: int) -> None:
-        if len(self.selected) == 0:
-            self.select_single(x, y)
+    def for_all_selected(self, fn: Callable[[Selection], None]) -> None:
+        selection = self.selection()
+        if selection is None:
             return
 
+        fn(selection)
+        self.redraw()
 
-        first = self.selected[0]
-        sx = first.x
-        sy = first.y
 
-        x_is_backwards = x < sx
-        y_is_backwards = y < sy
+    def paint_at(self, cell: tuple[int, int]) -> None:
+        """Applies `paint` to the disc of `brush_radius` cells around `cell`"""
+        if self.paint is None:
+            return
 
-        x_range = range(sx, x - 1, -1) if x_is_backwards else range(sx, x + 1)
-        y_range = range(sy, y - 1, -1) if y_is_backwards else range(sy, y + 1)
+        row, col = cell
+        radius = self.brush_radius
+        rows = slice(max(row - radius, 0), min(row + radius + 1, self.cells.rows))
+        cols = slice(max(col - radius, 0), min(col + radius + 1, self.cells.cols))
+        dy = np.arange(rows.start, rows.stop)[:, None] - row
+        dx = np.arange(cols.start, cols.stop)[None, :] - col
+        self.paint((rows, cols), dx * dx + dy * dy <= radius * radius)
+        self.redraw()
 
-        for x_pos in x_range:
-            for y_pos in y_range:
-                # Don't append the currently selected cell twice!
-                if x_pos == sx and y_pos == sy:
-                    continue
 
-                # Don't store it in a variable, because python sucks, and overrides it :(
-                self.cells[x_pos][y_pos].select()
-                self.selected.append(self.cells[x_pos][y_pos])
+    def set_state(self, state: CellState) -> None:
+        def apply(selection: Selection) -> None:
+            self.cells.state[selection] = state.code()
 
+        def paint(selection: Selection, mask: npt.NDArray[np.bool_]) -> None:
+            self.cells.state[selection][mask] = state.code()
 
-        # Set the selected cell as the first element
-        self.selected.remove(self.cells[x][y])
-        self.selected.insert(0, self.cells[x][y])
+        self.for_all_selected(apply)
+        self.paint = paint
 
 
-    def reset_selected(self) -> None:
-        for selected in self.selected:
-            selected.unselect()
+    def set_type(self, type: VegType) -> None:
+        def apply(selection: Selection) -> None:
+            self.cells.type[selection] = type.code()
 
-        self.selected.clear()
+        def paint(selection: Selection, mask: npt.NDArray[np.bool_]) -> None:
+            self.cells.type[selection][mask] = type.code()
 
+        self.for_all_selected(apply)
+        self.paint = paint
 
-    def for_all_selected(self, fn: Callable[[Cell], None]) -> None:
-        for cell in self.selected:
-            fn(cell)
-            cell.update_cell()
 
-    
-    def multi_select(self) -> bool:
-        return len(self.selected) > 1
+    def set_moisture(self, moisture: int, increment: bool) -> None:
+        def apply(selection: Selection) -> None:
+            base = self.cells.moisture[selection].astype(np.int64) if increment else 0
+            self.cells.moisture[selection] = np.clip(base + moisture, 0, 100)
+
+        self.for_all_selected(apply)
 
 
 @final
@@ -333,7 +510,7 @@ class SettingsFrame(tk.CTkFrame):
     def __init__(self, master, cellgrid: CellGridFrame):
         super().__init__(master)
         _ = self.grid_columnconfigure(0, weight=1)
-        _ = self.grid_rowconfigure(iota(4), weight=1)
+        _ = self.grid_rowconfigure(iota(5), weight=1)
 
         self.cellgrid: CellGridFrame = cellgrid
 
@@ -352,6 +529,14 @@ class SettingsFrame(tk.CTkFrame):
         self.moisture_meter.grid(row=1, column=0, pady=10, padx=10)
         self.moisture_meter.set(0)
 
+        # The brush paints the last chosen state or vegetation type where the mouse drags
+        self.brush = tk.CTkSwitch(self.number_settings, text="brush", command=self.brush_callback)
+        self.brush.grid(row=2, column=0, pady=10, padx=10)
+
+        self.brush_radius = Spinbox(self.number_settings, step_size=1, command=self.brush_radius_callback)
+        self.brush_radius.grid(row=3, column=0, pady=10, padx=10)
+        self.brush_radius.set(0)
+
         self.onfire = tk.CTkButton(self, text="onfire", command=lambda: self.set_selected_cellstate(CellState.ONFIRE), width=100, height=100)
         self.onfire.grid(row=1, column=0, padx=10, pady=10)
 
@@ -362,28 +547,40 @@ class SettingsFrame(tk.CTkFrame):
         self.normal.grid(row=3, column=0, padx=10, pady=10)
 
 
-    def update_selected(self, selected: list[Cell]) -> None:
-        if len(selected) == 0:
+    def update_selected(self, selected: CellGridFrame) -> None:
+        selection = selected.selection()
+        if selection is None:
             return
 
-        if len(selected) > 1:
+        if selected.multi_select():
             self.moisture_meter.set(0)
         else:
-            self.moisture_meter.set(selected[0].moisture)
+            rows, cols = selection
+            self.moisture_meter.set(int(selected.cells.moisture[rows.start, cols.start]))
 
 
     def set_selected_cellstate(self, state: CellState) -> None:
-        self.cellgrid.for_all_selected(lambda cell: cell.set_state(state))
+        self.cellgrid.set_state(state)
 
 
     def moisture_callback(self, moist: int) -> None:
         # If we have multiple cells selected at once, we increment by the amount
         if self.cellgrid.multi_select():
-            self.cellgrid.for_all_selected(lambda cell: cell.set_moisture(cell.moisture + moist))
+            self.cellgrid.set_moisture(moist, increment=True)
             self.moisture_meter.set(0) # Reset the value, so we don't increment twice
         # Only 1 selected, we just set the value directly:
         else:
-            self.cellgrid.for_all_selected(lambda cell: cell.set_moisture(moist))
+            self.cellgrid.set_moisture(moist, increment=False)
+
+
+    def brush_callback(self) -> None:
+        self.cellgrid.brush_on = bool(self.brush.get())
+
+
+    def brush_radius_callback(self, radius: int) -> None:
+        if radius < 0:
+            self.brush_radius.set(0)
+        self.cellgrid.brush_radius = max(radius, 0)
 
 
 @final
@@ -430,9 +627,13 @@ class App(tk.CTk):
             _ = stderr.write("Invalid parameters!!")
             exit(1)
 
-        in_file = open(argv[3], mode="rb") if len(argv) == 4 else None
+        if len(argv) == 4:
+            with open(argv[3], mode="rb") as in_file:
+                cells = load_cellgrid(in_file.read(), size)
+        else:
+            cells = CellGrid(*size)
 
-        self.cellgrid = CellGridFrame(self, size, self.update_selected, in_file)
+        self.cellgrid = CellGridFrame(self, cells, self.update_selected)
         self.cellgrid.grid(row=0, column=0, rowspan=2, padx=10, pady=10, sticky="sw")
 
         self.viewmodes = ViewModeFrame(self, self.update_viewmode)
@@ -453,9 +654,7 @@ class App(tk.CTk):
 
     def export(self) -> None:
         writer = stdout.buffer
-        for row in self.cellgrid.cells:
-            _ = writer.writelines([(cell.serialize() + "\n").encode() for cell in row])
-
+        _ = writer.write(export_cellgrid(self.cellgrid.cells))
         _ = writer.flush()
 
         exit(0)
@@ -466,25 +665,21 @@ class App(tk.CTk):
 
 
     def set_veg_type(self, type: VegType) -> None:
-        self.cellgrid.for_all_selected(lambda cell: cell.set_type(type))
+        self.cellgrid.set_type(type)
 
 
-    def update_selected(self, selected: list[Cell]) -> None:
+    def update_selected(self, selected: CellGridFrame) -> None:
         self.settings.update_selected(selected)
 
 
     def update_viewmode(self, mode: ViewMode) -> None:
         _ = mode
-        for row in self.cellgrid.cells:
-            for cell in row:
-                cell.update_cell()
+        self.cellgrid.redraw()
 
 
 
 if __name__ == "__main__":
     app = App()
-    _ = app.bind("<KeyPress>", on_press_key)
-    _ = app.bind("<KeyRelease>", on_release_key)
     _ = app.bind("<Button-3>", lambda _: app.cellgrid.reset_selected())
     app.mainloop()
 
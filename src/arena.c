@@ -0,0 +1,195 @@
+#define _GNU_SOURCE // MAP_HUGETLB, MAP_POPULATE and MADV_HUGEPAGE
+#include "arena.h"
+#include "cell.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static size_t gridBytes(size_t num_rows, size_t num_columns) {
+    return alignUp(num_rows * sizeof(CellArray), ARENA_ALIGNMENT)
+         + alignUp(num_rows * num_columns * sizeof(Cell), ARENA_ALIGNMENT);
+}
+
+size_t arenaGridBytes(size_t num_rows, size_t num_columns, size_t num_grids) {
+    return num_grids * (gridBytes(num_rows, num_columns) + ARENA_ALIGNMENT)
+         + alignUp(num_grids * sizeof(CellArray*), ARENA_ALIGNMENT);
+}
+
+SimArena* createArena(size_t capacity, ArenaFlags flags) {
+    SimArena* arena = malloc(sizeof(SimArena));
+    if (!arena) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const int populate = (flags & ARENA_PREFAULT) ? MAP_POPULATE : 0;
+    void* base = MAP_FAILED;
+    size_t mapped_bytes = 0;
+    bool huge_pages = false;
+    bool transparent_huge_pages = false;
+
+    // Explicit huge pages fail right away if none are reserved, then we fall back to normal pages
+    if ((flags & ARENA_HUGE_PAGES) && capacity >= huge_page_size) {
+        mapped_bytes = alignUp(capacity, huge_page_size);
+        base = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        huge_pages = base != MAP_FAILED;
+    }
+
+    if (base == MAP_FAILED) {
+        mapped_bytes = alignUp(capacity, (size_t)sysconf(_SC_PAGESIZE));
+        const bool want_thp = (flags & ARENA_TRANSPARENT_HUGE_PAGES) && capacity >= huge_page_size;
+
+        // Populating before the madvise would fault in small pages, so we touch it ourselves afterwards
+        base = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | (want_thp ? 0 : populate), -1, 0);
+        if (base == MAP_FAILED) {
+            fprintf(stderr, "Failed to reserve %zu bytes for the simulation arena\n", capacity);
+            free(arena);
+            return nullptr;
+        }
+
+        if (want_thp) {
+            transparent_huge_pages = madvise(base, mapped_bytes, MADV_HUGEPAGE) == 0;
+            if (flags & ARENA_PREFAULT)
+                memset(base, 0, mapped_bytes);
+        }
+    }
+
+    *arena = (SimArena) {
+        .base = base,
+        .capacity = capacity,
+        .used = 0,
+        .mapped_bytes = mapped_bytes,
+        .free_grids = nullptr,
+        .stats = {
+            .reserved_bytes = mapped_bytes,
+            .huge_pages = huge_pages,
+            .transparent_huge_pages = transparent_huge_pages,
+        },
+    };
+    return arena;
+}
+
+void destroyArena(SimArena* arena) {
+    if (!arena)
+        return;
+
+    munmap(arena->base, arena->mapped_bytes);
+    free(arena);
+}
+
+void* arenaAlloc(SimArena* arena, size_t bytes) {
+    const size_t start = alignUp(arena->used, ARENA_ALIGNMENT);
+    if (start + bytes > arena->capacity) {
+        fprintf(stderr, "Simulation arena exhausted: %zu of %zu bytes used, %zu more requested\n",
+                arena->used, arena->capacity, bytes);
+        exit(EXIT_FAILURE);
+    }
+
+    arena->used = start + bytes;
+    arena->stats.used_bytes = arena->used;
+    arena->stats.allocations++;
+    return arena->base + start;
+}
+
+// Carves a new grid out of the arena, with the row table pointing into its cells
+static CellArray* carveGrid(SimArena* arena) {
+    CellArray* rows = arenaAlloc(arena, arena->num_rows * sizeof(CellArray));
+    Cell* cells = arenaAlloc(arena, arena->num_rows * arena->num_columns * sizeof(Cell));
+
+    for (size_t row = 0; row < arena->num_rows; row++) {
+        rows[row] = (CellArray) {
+            .count = arena->num_columns,
+            .elements = cells + row * arena->num_columns,
+        };
+    }
+    return rows;
+}
+
+void arenaReserveGrids(SimArena* arena, size_t num_rows, size_t num_columns, size_t num_grids) {
+    assert(arena->free_grids == nullptr && "The grid pool can only be set up once");
+
+    arena->num_rows = num_rows;
+    arena->num_columns = num_columns;
+    arena->free_grids = arenaAlloc(arena, num_grids * sizeof(CellArray*));
+    arena->max_free_grids = num_grids;
+    arena->num_free_grids = 0;
+
+    for (size_t grid = 0; grid < num_grids; grid++)
+        arena->free_grids[arena->num_free_grids++] = carveGrid(arena);
+}
+
+CellArray* arenaAcquireGrid(SimArena* arena) {
+    assert(arena->free_grids != nullptr && "arenaReserveGrids has to be called first");
+    arena->stats.grid_acquires++;
+
+    if (arena->num_free_grids > 0)
+        return arena->free_grids[--arena->num_free_grids];
+
+    // More grids alive at once than reserved, so the pool has to grow
+    arena->stats.grid_misses++;
+    return carveGrid(arena);
+}
+
+void arenaReleaseGrid(SimArena* arena, CellArray* rows) {
+    // Grids carved after a miss don't fit in the pool, their memory stays with the arena
+    if (arena->num_free_grids == arena->max_free_grids)
+        return;
+
+    arena->free_grids[arena->num_free_grids++] = rows;
+}
+
+CellularAutomaton moveIntoArena(CellularAutomaton* automaton, SimArena* arena) {
+    assert(automaton->arena == nullptr && "The automaton is already in an arena");
+    assert(automaton->num_rows == arena->num_rows && automaton->rows[0].count == arena->num_columns);
+
+    CellArray* rows = arenaAcquireGrid(arena);
+    memcpy(rows[0].elements, automaton->rows[0].elements, arena->num_rows * arena->num_columns * sizeof(Cell));
+
+    CellularAutomaton moved = *automaton;
+    moved.rows = rows;
+    moved.arena = arena;
+    if (moved.terrain && !moved.terrain->arena)
+        moveTerrainIntoArena(moved.terrain, arena);
+    if (moved.wind && !moved.wind->arena)
+        moveWindFieldIntoArena(moved.wind, arena);
+
+    destroyAutomaton(automaton);
+    return moved;
+}
+
+ArenaStats arenaStats(const SimArena* arena) {
+    return arena->stats;
+}
+
+void printArenaStats(const SimArena* arena, FILE* fd) {
+    const ArenaStats stats = arena->stats;
+    fprintf(fd,
+            "(Arena) {\n"
+                "\t.reserved = %zu bytes\n"
+                "\t.used = %zu bytes\n"
+                "\t.allocations = %zu\n"
+                "\t.grid_acquires = %zu\n"
+                "\t.grid_misses = %zu\n"
+                "\t.pages = %s\n"
+            "}\n",
+            stats.reserved_bytes,
+            stats.used_bytes,
+            stats.allocations,
+            stats.grid_acquires,
+            stats.grid_misses,
+            stats.huge_pages ? "huge" : stats.transparent_huge_pages ? "transparent huge" : "normal"
+    );
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "cell.h"
+#include <stdio.h>
+
+// Alignment of everything handed out by the arena, a cache line and the widest SIMD register
+#define ARENA_ALIGNMENT 64
+
+typedef enum ArenaFlags {
+    ARENA_DEFAULT = 0,
+    // Try explicit huge pages (MAP_HUGETLB), needs pages reserved in /proc/sys/vm/nr_hugepages
+    ARENA_HUGE_PAGES = 1 << 0,
+    // Ask for transparent huge pages, used if explicit huge pages are off or unavailable
+    ARENA_TRANSPARENT_HUGE_PAGES = 1 << 1,
+    // Fault every page in when the arena is created, instead of during the first steps
+    ARENA_PREFAULT = 1 << 2,
+} ArenaFlags;
+
+typedef struct ArenaStats {
+    size_t reserved_bytes;
+    size_t used_bytes;
+    size_t allocations;   // blocks carved out of the arena
+    size_t grid_acquires; // grids handed out for clones
+    size_t grid_misses;   // grids that had to be carved because the pool was empty
+    bool huge_pages;      // backed by MAP_HUGETLB
+    bool transparent_huge_pages;
+} ArenaStats;
+
+/// One region reserved up front for all planes and scratch buffers of a simulation.
+/// Memory is bumped out of it and never given back one by one, except for the grids used by
+/// `cloneAutomaton`, which are recycled through a pool. So once the pool is warm, stepping
+/// doesn't allocate at all.
+struct SimArena {
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+    size_t mapped_bytes; // capacity rounded up to the page size used
+
+    // Grid pool, every grid has the same dimensions
+    size_t num_rows;
+    size_t num_columns;
+    CellArray** free_grids;
+    size_t num_free_grids;
+    size_t max_free_grids;
+
+    ArenaStats stats;
+};
+
+/// Bytes needed for `num_grids` grids of the given size, plus the pool bookkeeping
+size_t arenaGridBytes(size_t num_rows, size_t num_columns, size_t num_grids);
+
+/// Reserves the arena, returns null if the memory couldn't be mapped
+SimArena* createArena(size_t capacity, ArenaFlags flags);
+void destroyArena(SimArena* arena);
+
+/// Bump allocates `bytes` aligned to ARENA_ALIGNMENT, exits if the arena is exhausted
+void* arenaAlloc(SimArena* arena, size_t bytes);
+
+/// Sets the grid dimensions of the pool and carves `num_grids` grids into it up front
+void arenaReserveGrids(SimArena* arena, size_t num_rows, size_t num_columns, size_t num_grids);
+
+/// Takes a grid from the pool, its cells are uninitialized
+CellArray* arenaAcquireGrid(SimArena* arena);
+/// Gives a grid from `arenaAcquireGrid` back to the pool
+void arenaReleaseGrid(SimArena* arena, CellArray* rows);
+
+/// Copies the automaton into a grid from the arena, and frees the malloc'ed original.
+/// The slope factors of its terrain and the tables of its wind field move along, unless they are
+/// in an arena already, e.g. a terrain shared with the automaton it was cloned from.
+CellularAutomaton moveIntoArena(CellularAutomaton* automaton, SimArena* arena);
+
+ArenaStats arenaStats(const SimArena* arena);
+void printArenaStats(const SimArena* arena, FILE* fd);
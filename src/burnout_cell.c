@@ -1,4 +1,7 @@
 #include "burnout_cell.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
 
 static const size_t burn_durations[VEG_LAST] = {
     1,  // Broadleaves
@@ -9,6 +12,79 @@ static const size_t burn_durations[VEG_LAST] = {
     49, // Not fireprone
 };
 
+size_t burnDuration(VegType type) {
+    return burn_durations[vegTypeIndex(type)];
+}
+
+static_assert(BURNOUT_WHEEL_SLOTS > 49, "The wheel must cover the longest burn duration");
+static_assert((BURNOUT_WHEEL_SLOTS & (BURNOUT_WHEEL_SLOTS - 1)) == 0, "The wheel size must be a power of two");
+
+BurnoutWheel createBurnoutWheel(const CellularAutomaton* automaton) {
+    const size_t num_columns = automaton->rows[0].count;
+    const size_t num_cells = automaton->num_rows * num_columns;
+
+    SimArena* arena = automaton->arena;
+    BurnoutWheel wheel = {
+        .next = arena ? arenaAlloc(arena, num_cells * sizeof(size_t)) : malloc(num_cells * sizeof(size_t)),
+        .num_columns = num_columns,
+        .num_scheduled = 0,
+        .arena = arena,
+    };
+    if (!wheel.next) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    resetBurnoutWheel(&wheel, automaton);
+    return wheel;
+}
+
+void resetBurnoutWheel(BurnoutWheel* wheel, const CellularAutomaton* automaton) {
+    for (size_t slot = 0; slot < BURNOUT_WHEEL_SLOTS; slot++)
+        wheel->heads[slot] = BURNOUT_WHEEL_EMPTY;
+    wheel->num_scheduled = 0;
+
+    // The cells burning from the start ignited in the current step
+    for (size_t row = 0; row < automaton->num_rows; row++) {
+        const CellArray arr = automaton->rows[row];
+        for (size_t col = 0; col < arr.count; col++) {
+            const Cell* cell = &arr.elements[col];
+            if (cell->state == CELLSTATE_ONFIRE)
+                scheduleBurnout(wheel, automaton->step, row, col, cell->type);
+        }
+    }
+}
+
+void destroyBurnoutWheel(BurnoutWheel* wheel) {
+    if (!wheel->arena)
+        free(wheel->next);
+    wheel->next = nullptr;
+}
+
+void scheduleBurnout(BurnoutWheel* wheel, size_t step, size_t row, size_t col, VegType type) {
+    // Same step as the counter would reach the duration in `isBurnedOut`
+    const size_t due = step + burn_durations[vegTypeIndex(type)];
+    const size_t slot = due & (BURNOUT_WHEEL_SLOTS - 1);
+    const size_t index = row * wheel->num_columns + col;
+
+    wheel->next[index] = wheel->heads[slot];
+    wheel->heads[slot] = index;
+    wheel->num_scheduled++;
+}
+
+size_t nextBurnoutStep(const BurnoutWheel* wheel, size_t step) {
+    if (wheel->num_scheduled == 0)
+        return BURNOUT_WHEEL_EMPTY;
+
+    // Nothing is scheduled further ahead than one lap of the wheel
+    for (size_t ahead = 0; ahead < BURNOUT_WHEEL_SLOTS; ahead++) {
+        if (wheel->heads[(step + ahead) & (BURNOUT_WHEEL_SLOTS - 1)] != BURNOUT_WHEEL_EMPTY)
+            return step + ahead;
+    }
+
+    return BURNOUT_WHEEL_EMPTY;
+}
+
 // The function that checks if a cell is burned out
 static bool isBurnedOut(const Cell *cell)
 {
@@ -24,28 +100,49 @@ static bool isBurnedOut(const Cell *cell)
     return cell->on_fire_counter >= duration;
 }
 
+void burnCell(Cell* cell) {
+    // Check if the cell is burned out
+    if (isBurnedOut(cell)) {
+        cell->state = CELLSTATE_BURNT;
+
+      // If the cell is burning apply the counter
+    } else if (cell->state == CELLSTATE_ONFIRE) {
+        cell->on_fire_counter++;
+    }
+}
+
+// Only visits the cells whose burnout is due in this step
+static void burnoutScheduledCells(const CellularAutomaton* automaton, CellularAutomaton* res) {
+    BurnoutWheel* wheel = automaton->burnout;
+    const size_t slot = automaton->step & (BURNOUT_WHEEL_SLOTS - 1);
+
+    for (size_t index = wheel->heads[slot]; index != BURNOUT_WHEEL_EMPTY; index = wheel->next[index]) {
+        const size_t row = index / wheel->num_columns;
+        const size_t col = index % wheel->num_columns;
+        res->rows[row].elements[col].state = CELLSTATE_BURNT;
+        wheel->num_scheduled--;
+    }
+
+    wheel->heads[slot] = BURNOUT_WHEEL_EMPTY;
+}
+
 CellularAutomaton burnoutCells(const CellularAutomaton* automaton) {
     CellularAutomaton res = cloneAutomaton(automaton);
+    res.step = automaton->step + 1;
+
+    if (automaton->burnout) {
+        burnoutScheduledCells(automaton, &res);
+        return res;
+    }
 
     // Looping through all the rows
     for (size_t row = 0; row < res.num_rows; row++) {
-        const CellArray arr = automaton->rows[row];
         const CellArray out_arr = res.rows[row];
 
             //Loop through all the collums in the rows
-        for (size_t col = 0; col < arr.count; col++) {
-            // get actual cell insted of the cloned version
-            const Cell* cell = &arr.elements[col];
-            Cell* out_cell = &out_arr.elements[col];
-
-            // Check if the cell is burned out
-            if (isBurnedOut(cell)) {
-                out_cell->state = CELLSTATE_BURNT;
-
-              // If the cell is burning apply the counter
-            } else if (cell->state == CELLSTATE_ONFIRE) {
-                out_cell->on_fire_counter++;
-            }
+        for (size_t col = 0; col < out_arr.count; col++) {
+            // The output is a copy of the cell, so we can burn it in place
+            burnCell(&out_arr.elements[col]);
         }
     }
 
@@ -1,5 +1,40 @@
 #pragma once
 #include "cell.h"
 
+// Number of buckets in the wheel, must be a power of two larger than the longest burn duration
+#define BURNOUT_WHEEL_SLOTS 64
+#define BURNOUT_WHEEL_EMPTY ((size_t)-1)
+
+/// Timing wheel of pending burnouts, keyed by the step the cell burns out in.
+/// Every cell is at most in one bucket at a time, so the buckets are linked lists
+/// threaded through `next`, which means scheduling never allocates.
+struct BurnoutWheel {
+    size_t heads[BURNOUT_WHEEL_SLOTS];
+    size_t* next; // one link per cell, indexed by row * num_columns + col
+    size_t num_columns;
+    size_t num_scheduled;
+    SimArena* arena; // where `next` lives, if null it was malloc'ed
+};
+
+/// Creates a wheel for the automaton and schedules the cells that are already burning.
+/// The links come from the arena of the automaton if it has one.
+BurnoutWheel createBurnoutWheel(const CellularAutomaton* automaton);
+void destroyBurnoutWheel(BurnoutWheel* wheel);
+/// Empties the wheel and schedules the cells burning in the automaton again, without allocating
+void resetBurnoutWheel(BurnoutWheel* wheel, const CellularAutomaton* automaton);
+
+/// Schedules the burnout of a cell that ignited during `step`
+void scheduleBurnout(BurnoutWheel* wheel, size_t step, size_t row, size_t col, VegType type);
+
+/// Returns the first step at or after `step` where a cell burns out, or BURNOUT_WHEEL_EMPTY
+size_t nextBurnoutStep(const BurnoutWheel* wheel, size_t step);
+
 /// Modifies the Cellular Automaton by applying burning the cells within
 CellularAutomaton burnoutCells(const CellularAutomaton* automaton);
+
+/// Number of steps a cell of this vegetation burns before it is burnt out
+size_t burnDuration(VegType type);
+
+/// Burns a single cell for one step, counting how long it has been on fire.
+/// This is what `burnoutCells` does to every cell when there is no wheel.
+void burnCell(Cell* cell);
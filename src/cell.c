@@ -1,4 +1,5 @@
 #include "cell.h"
+#include "arena.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -76,34 +77,60 @@ CellularAutomaton cloneAutomaton(const CellularAutomaton* orig) {
     const int windX = orig->windX;
     const int windY = orig->windY;
     const WindSpeed speed = orig->speed;
+    const size_t step = orig->step;
+    BurnoutWheel* burnout = orig->burnout;
+    Terrain* terrain = orig->terrain;
+    WindField* wind = orig->wind;
+    SimArena* arena = orig->arena;
     const size_t num_rows = orig->num_rows;
     assert(num_rows > 0 && "Automaton was empty");
 
     const size_t num_columns = orig->rows[0].count;
 
     const size_t cell_bytes = num_columns * num_rows * sizeof(Cell);
-    CellArray* out_rows = malloc(num_rows * sizeof(CellArray));
-    Cell* out_cells = malloc(cell_bytes);
-    memcpy(out_cells, orig->rows[0].elements, cell_bytes);
-    for (size_t row = 0; row < num_rows; row++) {
-        Cell* row_cells = out_cells + row * num_columns;
+    CellArray* out_rows;
+    if (arena) {
+        // The row table of a pooled grid already points into its cells
+        out_rows = arenaAcquireGrid(arena);
+        memcpy(out_rows[0].elements, orig->rows[0].elements, cell_bytes);
+    } else {
+        out_rows = malloc(num_rows * sizeof(CellArray));
+        Cell* out_cells = malloc(cell_bytes);
+        if (!out_rows || !out_cells) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(out_cells, orig->rows[0].elements, cell_bytes);
+        for (size_t row = 0; row < num_rows; row++) {
+            Cell* row_cells = out_cells + row * num_columns;
 
-        out_rows[row] = (CellArray) {
-            .count = num_columns,
-            .elements = row_cells,
-        };
+            out_rows[row] = (CellArray) {
+                .count = num_columns,
+                .elements = row_cells,
+            };
+        }
     }
 
     return (CellularAutomaton) {
         .windX = windX,
         .windY = windY,
         .speed = speed,
+        .step = step,
+        .burnout = burnout,
+        .terrain = terrain,
+        .wind = wind,
+        .arena = arena,
         .num_rows = num_rows,
         .rows = out_rows,
     };
 }
 
 void destroyAutomaton(const CellularAutomaton* automaton) {
+    if (automaton->arena) {
+        arenaReleaseGrid(automaton->arena, automaton->rows);
+        return;
+    }
+
     free(automaton->rows[0].elements);
     free(automaton->rows);
 }
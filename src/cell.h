@@ -63,17 +63,43 @@ typedef struct CellArray {
     size_t count;
 } CellArray;
 
+// Defined in burnout_cell.h, shared between all clones of an automaton
+typedef struct BurnoutWheel BurnoutWheel;
+// Defined in terrain.h, read-only and shared between all clones of an automaton
+typedef struct Terrain Terrain;
+// Defined in wind_field.h, shared between all clones of an automaton
+typedef struct WindField WindField;
+// Defined in arena.h, where the grids of the automaton come from if set
+typedef struct SimArena SimArena;
+
 typedef struct CellularAutomaton {
     CellArray* rows;
     size_t num_rows;
     int windX;
     int windY;
     WindSpeed speed;
+    // Number of completed time steps, bumped by `burnoutCells`
+    size_t step;
+    // Optional burnout schedule, if null every burning cell is counted each step
+    BurnoutWheel* burnout;
+    // Optional elevation, if null the terrain is flat
+    Terrain* terrain;
+    // Optional wind per block of cells, if null the wind above is used everywhere
+    WindField* wind;
+    // Optional arena, clones then recycle its grids instead of calling malloc
+    SimArena* arena;
     /* other stuff maybe */
 } CellularAutomaton;
 void printAutomaton(const CellularAutomaton* automaton, FILE* fd);
 void destroyAutomaton(const CellularAutomaton* automaton);
 
+/// Index of the neighbour at offset (dx, dy) in per-neighbour tables with 8 entries.
+/// The neighbours are numbered row by row, skipping the cell itself.
+static inline size_t neighbourIndex(int dx, int dy) {
+    const int index = (dy + 1) * 3 + (dx + 1);
+    return (size_t)(index > 4 ? index - 1 : index);
+}
+
 typedef void (*cellProc)(const CellularAutomaton* automaton, size_t row, size_t col, void* userdata);
 void forEachCell(const CellularAutomaton* automaton, cellProc fn, void* userdata);
 
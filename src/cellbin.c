@@ -0,0 +1,199 @@
+#include "cellbin.h"
+#include "cell.h"
+#include "input.h"
+#include "terrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+CellbinHeader makeCellbinHeader(size_t width, size_t height, int windX, int windY, WindSpeed speed) {
+    CellbinHeader header = {
+        .width = width,
+        .height = height,
+        .windX = windX,
+        .windY = windY,
+        .speed = (int32_t)speed,
+        .cell_bytes = sizeof(PackedCell),
+    };
+    memcpy(header.magic, CELLBIN_MAGIC, sizeof(header.magic));
+    return header;
+}
+
+bool validateCellbinHeader(const CellbinHeader* header, size_t file_size, const char* path) {
+    if (memcmp(header->magic, CELLBIN_MAGIC, sizeof(header->magic)) != 0) {
+        fprintf(stderr, "ERROR: \"%s\" is not a .cellbin file\n", path);
+        return false;
+    }
+    if (header->cell_bytes != sizeof(PackedCell)) {
+        fprintf(stderr, "ERROR: \"%s\" has %u byte cells, expected %zu\n", path, header->cell_bytes, sizeof(PackedCell));
+        return false;
+    }
+    if (header->windX > 1 || header->windX < -1 || header->windY > 1 || header->windY < -1) {
+        fputs("ERROR: Header value \"windX\" or \"windY\" is not between 1 and -1\n", stderr);
+        return false;
+    }
+    if (header->speed < 0 || header->speed > 4) {
+        fputs("ERROR: Header value \"speed\" is not between 0 and 4\n", stderr);
+        return false;
+    }
+    if (file_size < sizeof(CellbinHeader) + header->width * header->height * sizeof(PackedCell)) {
+        fprintf(stderr, "ERROR: \"%s\" is too small for a %llu x %llu grid\n", path,
+                (unsigned long long)header->width, (unsigned long long)header->height);
+        return false;
+    }
+    return true;
+}
+
+bool convertCellgridToCellbin(const char* cellgrid_path, const char* cellbin_path) {
+    CellgridReader reader;
+    if (!openCellgrid(cellgrid_path, &reader))
+        return false;
+
+    FILE* out = fopen(cellbin_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open file: %s\n", cellbin_path);
+        fclose(reader.fd);
+        return false;
+    }
+
+    const CellbinHeader header = makeCellbinHeader(reader.width, reader.height, reader.windX, reader.windY, reader.speed);
+    if (fwrite(&header, sizeof(header), 1, out) != 1)
+        goto err_failed_write;
+
+    // Buffered a row at a time
+    PackedCell* row = malloc(reader.width * sizeof(PackedCell));
+    if (!row && reader.width > 0) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t row_num = 0; row_num < reader.height; row_num++) {
+        for (size_t col = 0; col < reader.width; col++) {
+            Cell cell;
+            float elevation;
+            if (!readNextCell(&reader, &cell, &elevation)) {
+                free(row);
+                goto err_close;
+            }
+            row[col] = packCell(&cell);
+        }
+
+        if (fwrite(row, sizeof(PackedCell), reader.width, out) != reader.width) {
+            free(row);
+            goto err_failed_write;
+        }
+    }
+    free(row);
+
+    if (!closeCellgrid(&reader)) {
+        fclose(out);
+        return false;
+    }
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "ERROR: failed to write file \"%s\"\n", cellbin_path);
+        return false;
+    }
+    return true;
+
+err_failed_write:
+    fprintf(stderr, "ERROR: failed to write file \"%s\"\n", cellbin_path);
+
+err_close:
+    fclose(reader.fd);
+    fclose(out);
+    return false;
+}
+
+CellularAutomaton readCellbin(const char* path) {
+    const CellularAutomaton failed = {
+        .num_rows = 0,
+        .rows = nullptr,
+    };
+
+    FILE* fd = fopen(path, "rb");
+    if (!fd) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return failed;
+    }
+
+    CellbinHeader header;
+    fseek(fd, 0, SEEK_END);
+    const long file_size = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    if (file_size < 0 || fread(&header, sizeof(header), 1, fd) != 1
+        || !validateCellbinHeader(&header, (size_t)file_size, path)) {
+        fclose(fd);
+        return failed;
+    }
+
+    const size_t h = header.height;
+    const size_t w = header.width;
+    CellArray* cell_arrays = malloc(sizeof(CellArray) * h);
+    Cell* cells = malloc(sizeof(Cell) * h * w);
+    PackedCell* packed_row = malloc(sizeof(PackedCell) * w);
+    if (!cell_arrays || !cells || !packed_row) {
+        fprintf(stderr, "Out Of Memory\n");
+        fclose(fd);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t row = 0; row < h; row++) {
+        cell_arrays[row] = (CellArray) {
+            .count = w,
+            .elements = cells + row * w,
+        };
+
+        if (fread(packed_row, sizeof(PackedCell), w, fd) != w) {
+            fprintf(stderr, "ERROR: failed to read file \"%s\"\n", path);
+            free(packed_row);
+            free(cells);
+            free(cell_arrays);
+            fclose(fd);
+            return failed;
+        }
+        for (size_t col = 0; col < w; col++)
+            cells[row * w + col] = unpackCell(packed_row[col]);
+    }
+
+    free(packed_row);
+    fclose(fd);
+
+    return (CellularAutomaton) {
+        .num_rows = h,
+        .rows = cell_arrays,
+        .windX = header.windX,
+        .windY = header.windY,
+        .speed = (WindSpeed)header.speed,
+    };
+}
+
+bool writeCellbin(const CellularAutomaton* automaton, const char* path) {
+    FILE* fd = fopen(path, "wb");
+    if (!fd) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return false;
+    }
+
+    const size_t w = automaton->num_rows > 0 ? automaton->rows[0].count : 0;
+    const CellbinHeader header = makeCellbinHeader(w, automaton->num_rows, automaton->windX, automaton->windY, automaton->speed);
+    bool ok = fwrite(&header, sizeof(header), 1, fd) == 1;
+
+    PackedCell* packed_row = malloc(sizeof(PackedCell) * (w ? w : 1));
+    if (!packed_row) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t row = 0; ok && row < automaton->num_rows; row++) {
+        for (size_t col = 0; col < w; col++)
+            packed_row[col] = packCell(&automaton->rows[row].elements[col]);
+        ok = fwrite(packed_row, sizeof(PackedCell), w, fd) == w;
+    }
+
+    free(packed_row);
+    ok = fclose(fd) == 0 && ok;
+    if (!ok)
+        fprintf(stderr, "ERROR: failed to write file \"%s\"\n", path);
+    return ok;
+}
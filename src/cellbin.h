@@ -0,0 +1,62 @@
+#pragma once
+#include "cell.h"
+#include <stdint.h>
+
+/*
+ * Binary grid format, for grids too big for the text .cellgrid.
+ * A 64 byte header followed by 4 bytes per cell, row by row. It is laid out so the cells of a
+ * file can be memory mapped and used directly, which is what the out-of-core mode does.
+ */
+
+#define CELLBIN_MAGIC "CELLBIN1"
+
+typedef struct CellbinHeader {
+    char magic[8];
+    uint64_t width;
+    uint64_t height;
+    int32_t windX;
+    int32_t windY;
+    int32_t speed;
+    uint32_t cell_bytes; // sizeof(PackedCell), to catch incompatible files
+    uint8_t reserved[24];
+} CellbinHeader;
+static_assert(sizeof(CellbinHeader) == 64, "The cells have to start on a cache line");
+
+typedef struct PackedCell {
+    uint8_t state;          // CellState
+    uint8_t type;           // VegType
+    uint8_t moisture;       // percent, like in the text format
+    uint8_t on_fire_counter;
+} PackedCell;
+static_assert(sizeof(PackedCell) == 4, "PackedCell has to stay 4 bytes");
+
+static inline PackedCell packCell(const Cell* cell) {
+    return (PackedCell) {
+        .state = (uint8_t)cell->state,
+        .type = (uint8_t)cell->type,
+        .moisture = (uint8_t)(cell->moisture * 100.f + 0.5f),
+        .on_fire_counter = (uint8_t)(cell->on_fire_counter > UINT8_MAX ? UINT8_MAX : cell->on_fire_counter),
+    };
+}
+
+static inline Cell unpackCell(PackedCell packed) {
+    return (Cell) {
+        .moisture = (float)packed.moisture / 100.f,
+        .on_fire_counter = packed.on_fire_counter,
+        .type = (VegType)packed.type,
+        .state = (CellState)packed.state,
+    };
+}
+
+CellbinHeader makeCellbinHeader(size_t width, size_t height, int windX, int windY, WindSpeed speed);
+/// Checks the magic, cell size and header values, and that the file is big enough for the cells
+bool validateCellbinHeader(const CellbinHeader* header, size_t file_size, const char* path);
+
+/// Converts a text .cellgrid into a .cellbin one cell at a time, so it never holds the grid in memory.
+/// The elevation of the text grid is not carried over.
+bool convertCellgridToCellbin(const char* cellgrid_path, const char* cellbin_path);
+
+/// Loads a whole .cellbin into an automaton, like `readInitialState`
+CellularAutomaton readCellbin(const char* path);
+/// Writes the automaton as a .cellbin
+bool writeCellbin(const CellularAutomaton* automaton, const char* path);
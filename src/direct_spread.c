@@ -1,5 +1,10 @@
 #include "direct_spread.h"
 #include "cell.h"
+#include "burnout_cell.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include "wind_variants.h"
+#include "random.h"
 
 #include <assert.h>
 #include <math.h>
@@ -8,9 +13,9 @@
 #include <unistd.h>
 
 void spreadToNeighbors(const CellularAutomaton* automaton, CellularAutomaton* out, size_t row, size_t col);
-float chanceToSpread(const Cell* src, const Cell* dst, float a_w);
 
-float wind_effect_table[WIND_LAST][5] = {
+// Constant, so the specialized kernels below can fold the lookups away
+static const float wind_effect_table[WIND_LAST][5] = {
     // Wind factor, effect of wind and direction between the neighboring cell and the burning cell.
     //   0°     45°    90°    135°   180°
     {1.20f, 1.05f, 1.00f, 1.00f, 1.00f}, // 10 km/h
@@ -20,6 +25,17 @@ float wind_effect_table[WIND_LAST][5] = {
     {3.70f, 2.20f, 0.80f, 0.40f, 0.35f}  // 90 km/h
 };
 
+// tabel of nominal fire probability from source https://www.mdpi.com/2571-6255/3/3/26
+static const float nominals[VEG_LAST][VEG_LAST] = {
+    //   B      S     G     FP     AF   N
+    {.3f, .375f, .25f, .275f, .25f, .25f},      // B
+    {.375f, .375f, .475f, .4f, .3f, .475f},     // S
+    {.45f, .475f, .475f, .475f, .375f, .475f},  // G
+    {.225f, .325f, .25f, .35f, .2f, .35f},      // FP
+    {.25f, .25f, .3f, .475f, .35f, .25f},       // AF
+    {.075f, .1f, .075f, .275f, .075f, .075f},   // N
+};
+
 
 /// ax and ay represent one vector, and bx and by represent another
 /// we take the difference of the two vectors,
@@ -32,8 +48,25 @@ int windDifferenceIndex(int ax, int ay, int bx, int by) {
     return abs(new_x) + abs(new_y);
 }
 
-/// Modifies the Cellular Automaton by spreading the fire between cells
-CellularAutomaton directSpread(const CellularAutomaton* automaton) {
+float windFactor(int windX, int windY, WindSpeed speed, int dx, int dy) {
+    return wind_effect_table[speed][windDifferenceIndex(windX, windY, dx, dy)];
+}
+
+/// Sets the cell on fire in the output, unless something else already did this step
+static inline void igniteCell(CellularAutomaton* out, size_t row, size_t col) {
+    Cell* output_cell = &out->rows[row].elements[col];
+    if (output_cell->state == CELLSTATE_ONFIRE)
+        return;
+
+    // The fire spreads to the cell :)
+    output_cell->state = CELLSTATE_ONFIRE;
+    if (out->burnout)
+        scheduleBurnout(out->burnout, out->step, row, col, output_cell->type);
+}
+
+/// Modifies the Cellular Automaton by spreading the fire between cells,
+/// works for any wind, including a wind field
+CellularAutomaton directSpreadGeneric(const CellularAutomaton* automaton) {
     CellularAutomaton write_automaton = cloneAutomaton(automaton);
     // we iterate through our grid of cells
     for (size_t row = 0; row < automaton->num_rows; row++ ) {
@@ -60,6 +93,9 @@ void spreadToNeighbors(const CellularAutomaton* automaton, CellularAutomaton* ou
     assert(col < cells.count && "out of bounds");
     const Cell spreading_cell = cells.elements[col];
 
+    // With a wind field the factors were built for the whole block when the wind last changed
+    const float* block_weights = automaton->wind ? blockSpreadWeights(automaton->wind, row, col) : nullptr;
+
     // Looping over neighbouring cells
     for (int neighbour_row = (int)row - 1; neighbour_row <= (int)row + 1; neighbour_row++ ) {
         // if row is out of bounds = skip
@@ -71,8 +107,6 @@ void spreadToNeighbors(const CellularAutomaton* automaton, CellularAutomaton* ou
         }
         const CellArray neighbour_cell_arr = automaton->rows[neighbour_row];
 
-        const CellArray output_cell_arr = out->rows[neighbour_row];
-
         for (int neighbour_col = (int)col - 1; neighbour_col <= (int)col + 1; neighbour_col++) {
             // if column is out of bounds = skip
             if (neighbour_col < 0) {
@@ -83,9 +117,6 @@ void spreadToNeighbors(const CellularAutomaton* automaton, CellularAutomaton* ou
             }
             const Cell* neighbouring_cell = &neighbour_cell_arr.elements[neighbour_col];
 
-            Cell* output_cell = &output_cell_arr.elements[neighbour_col];
-
-
             if (neighbouring_cell->state != CELLSTATE_NORMAL) {
                 continue;
             }
@@ -93,52 +124,44 @@ void spreadToNeighbors(const CellularAutomaton* automaton, CellularAutomaton* ou
             int dx = neighbour_col - (int)col;
             int dy = neighbour_row - (int)row;
 
-            // Pick the correct index for the wind_effect_table
-            int angle_index = windDifferenceIndex(automaton->windX, automaton->windY, dx, dy);
+            float a_w;
+            if (block_weights) {
+                a_w = block_weights[neighbourIndex(dx, dy)];
+            } else {
+                // Pick the correct index for the wind_effect_table
+                int angle_index = windDifferenceIndex(automaton->windX, automaton->windY, dx, dy);
 
-            /* picking our wind factor value from the table, based on wind speed and direction
-               compared to the cell burning cell
-             */
-            float a_w = wind_effect_table[automaton->speed][angle_index];
+                /* picking our wind factor value from the table, based on wind speed and direction
+                   compared to the cell burning cell
+                 */
+                a_w = wind_effect_table[automaton->speed][angle_index];
+            }
+
+            // Slope factor was precomputed when the terrain was loaded
+            float a_h = automaton->terrain ? slopeFactor(automaton->terrain, row, col, dx, dy) : 1.0f;
 
             // calculating the chance the spreading cell will ignite the neighbouring cell
-            float chance = chanceToSpread(&spreading_cell, neighbouring_cell, a_w);
+            float chance = chanceToSpread(&spreading_cell, neighbouring_cell, a_w, a_h);
             // Generating a random number between 1 and 0, if the number i less than the chance, the fire will spread.
-            float randnum = (float)rand() / (float)RAND_MAX;
+            float randnum = simulationRandom();
             if (randnum >= chance) {
                 continue;
             }
 
-            // The fire spreads to the cell :)
-            output_cell->state = CELLSTATE_ONFIRE;
+            igniteCell(out, (size_t)neighbour_row, (size_t)neighbour_col);
         }
 
     }
 }
 
-float chanceToSpread(const Cell* src, const Cell* dst, float a_w) {
-
-    // tabel of nominal fire probability from source https://www.mdpi.com/2571-6255/3/3/26
-    float nominals[VEG_LAST][VEG_LAST] = {
-        //   B      S     G     FP     AF   N
-        {.3f, .375f, .25f, .275f, .25f, .25f},      // B
-        {.375f, .375f, .475f, .4f, .3f, .475f},     // S
-        {.45f, .475f, .475f, .475f, .375f, .475f},  // G
-        {.225f, .325f, .25f, .35f, .2f, .35f},      // FP
-        {.25f, .25f, .3f, .475f, .35f, .25f},       // AF
-        {.075f, .1f, .075f, .275f, .075f, .075f},   // N
-    };
-
+float chanceToSpread(const Cell* src, const Cell* dst, float a_w, float a_h) {
     // nominal fire probability
     float p_n = nominals[vegTypeIndex(dst->type)][vegTypeIndex(src->type)];
 
     // Fine fuel moisture content, between 0 and 1, the higher the drier.
     float e_m = 1 - dst->moisture;
 
-    // Slope angle set to 1, we will not implement this slope angle.
-    constexpr float a_h = 1.0f;
-
-    // wind and slope factor set to 1 for now
+    // combined wind and slope factor, the slope factor is 1 on flat terrain
     float a_wh = a_w * a_h;
 
     // algorith from source, spread probability from burning cell to neighboring cell
@@ -146,3 +169,116 @@ float chanceToSpread(const Cell* src, const Cell* dst, float a_w) {
 
     return p_burn;
 }
+
+/*
+ * Specialized kernels for uniform wind.
+ *
+ * `directSpreadKernel` is stamped out once per wind direction and speed, so the 8 wind factors
+ * are constants and the neighbour loop is unrolled. On flat terrain the `powf` of `chanceToSpread`
+ * only depends on the direction and the two vegetation types, so each call builds that table once
+ * up front. The neighbours are visited in the same order as `spreadToNeighbors`, so both paths
+ * draw the same random numbers and give the same result.
+ */
+
+typedef float ChanceTable[VEG_LAST][VEG_LAST];
+
+[[gnu::always_inline]]
+static inline void spreadToNeighbour(const CellularAutomaton* automaton, CellularAutomaton* out,
+                                     size_t row, size_t col, const Cell* src,
+                                     int dx, int dy, float a_w, const ChanceTable chances) {
+    // if the neighbour is out of bounds = skip
+    if ((dy < 0 && row == 0) || (dy > 0 && row + 1 >= automaton->num_rows))
+        return;
+    if ((dx < 0 && col == 0) || (dx > 0 && col + 1 >= automaton->rows[row].count))
+        return;
+
+    const size_t dst_row = (size_t)((ptrdiff_t)row + dy);
+    const size_t dst_col = (size_t)((ptrdiff_t)col + dx);
+    const Cell* dst = &automaton->rows[dst_row].elements[dst_col];
+    if (dst->state != CELLSTATE_NORMAL)
+        return;
+
+    float chance;
+    if (automaton->terrain) {
+        chance = chanceToSpread(src, dst, a_w, slopeFactor(automaton->terrain, row, col, dx, dy));
+    } else {
+        chance = chances[vegTypeIndex(dst->type)][vegTypeIndex(src->type)] * (1 - dst->moisture);
+    }
+
+    float randnum = simulationRandom();
+    if (randnum >= chance)
+        return;
+
+    igniteCell(out, dst_row, dst_col);
+}
+
+[[gnu::always_inline]]
+static inline void directSpreadKernel(const CellularAutomaton* automaton, CellularAutomaton* out,
+                                      int windX, int windY, WindSpeed speed) {
+    // Compile time constants in every variant
+    const float a_w[8] = {
+        windFactor(windX, windY, speed, -1, -1),
+        windFactor(windX, windY, speed,  0, -1),
+        windFactor(windX, windY, speed,  1, -1),
+        windFactor(windX, windY, speed, -1,  0),
+        windFactor(windX, windY, speed,  1,  0),
+        windFactor(windX, windY, speed, -1,  1),
+        windFactor(windX, windY, speed,  0,  1),
+        windFactor(windX, windY, speed,  1,  1),
+    };
+
+    // Same expression as in `chanceToSpread`, minus the moisture which depends on the cell
+    ChanceTable chances[8];
+    for (size_t direction = 0; direction < 8; direction++) {
+        for (size_t dst = 0; dst < VEG_LAST; dst++) {
+            for (size_t src = 0; src < VEG_LAST; src++)
+                chances[direction][dst][src] = 1 - powf(1 - nominals[dst][src], a_w[direction] * 1.0f);
+        }
+    }
+
+    for (size_t row = 0; row < automaton->num_rows; row++) {
+        const CellArray cell_arr = automaton->rows[row];
+        for (size_t col = 0; col < cell_arr.count; col++) {
+            const Cell* cell = &cell_arr.elements[col];
+            if (cell->state != CELLSTATE_ONFIRE)
+                continue;
+
+            spreadToNeighbour(automaton, out, row, col, cell, -1, -1, a_w[0], chances[0]);
+            spreadToNeighbour(automaton, out, row, col, cell,  0, -1, a_w[1], chances[1]);
+            spreadToNeighbour(automaton, out, row, col, cell,  1, -1, a_w[2], chances[2]);
+            spreadToNeighbour(automaton, out, row, col, cell, -1,  0, a_w[3], chances[3]);
+            spreadToNeighbour(automaton, out, row, col, cell,  1,  0, a_w[4], chances[4]);
+            spreadToNeighbour(automaton, out, row, col, cell, -1,  1, a_w[5], chances[5]);
+            spreadToNeighbour(automaton, out, row, col, cell,  0,  1, a_w[6], chances[6]);
+            spreadToNeighbour(automaton, out, row, col, cell,  1,  1, a_w[7], chances[7]);
+        }
+    }
+}
+
+typedef void (*DirectSpreadKernel)(const CellularAutomaton* automaton, CellularAutomaton* out);
+
+#define DEFINE_DIRECT_KERNEL(name, windX, windY, speed) \
+    static void directSpread_##name##_##speed(const CellularAutomaton* automaton, CellularAutomaton* out) { \
+        directSpreadKernel(automaton, out, windX, windY, (WindSpeed)speed); \
+    }
+FOR_EACH_WIND_VARIANT(DEFINE_DIRECT_KERNEL)
+#undef DEFINE_DIRECT_KERNEL
+
+static_assert(WIND_LAST == 5, "wind_variants.h has to list every wind speed");
+
+#define DIRECT_KERNEL_ENTRY(name, windX, windY, speed) [windY + 1][windX + 1][speed] = directSpread_##name##_##speed,
+static const DirectSpreadKernel direct_kernels[3][3][WIND_LAST] = {
+    FOR_EACH_WIND_VARIANT(DIRECT_KERNEL_ENTRY)
+};
+#undef DIRECT_KERNEL_ENTRY
+
+/// Modifies the Cellular Automaton by spreading the fire between cells
+CellularAutomaton directSpread(const CellularAutomaton* automaton) {
+    // The wind differs between blocks, only the generic path handles that
+    if (automaton->wind)
+        return directSpreadGeneric(automaton);
+
+    CellularAutomaton write_automaton = cloneAutomaton(automaton);
+    direct_kernels[automaton->windY + 1][automaton->windX + 1][automaton->speed](automaton, &write_automaton);
+    return write_automaton;
+}
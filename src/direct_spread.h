@@ -1,7 +1,13 @@
 #pragma once
 #include "cell.h"
 
-/// Modifies the Cellular Automaton by spreading the fire between cells
+/// Modifies the Cellular Automaton by spreading the fire between cells.
+/// Uniform wind is dispatched to a kernel specialized for its direction and speed.
 CellularAutomaton directSpread(const CellularAutomaton* automaton);
+/// The unspecialized version of `directSpread`, which handles any wind
+CellularAutomaton directSpreadGeneric(const CellularAutomaton* automaton);
 int windDifferenceIndex(int ax, int ay, int bx, int by);
-float chanceToSpread(const Cell* src, const Cell* dst, float a_w);
+/// Wind factor `a_w` for spreading to the neighbour at offset (dx, dy) with the given wind
+float windFactor(int windX, int windY, WindSpeed speed, int dx, int dy);
+/// Chance that `src` ignites `dst`, with wind factor `a_w` and slope factor `a_h`
+float chanceToSpread(const Cell* src, const Cell* dst, float a_w, float a_h);
@@ -1,87 +1,178 @@
 #include "display.h"
 #include "SDL3/SDL_error.h"
+#include "SDL3/SDL_events.h"
+#include "SDL3/SDL_keycode.h"
 #include "SDL3/SDL_log.h"
+#include "SDL3/SDL_mouse.h"
 #include "SDL3/SDL_stdinc.h"
 #include "SDL3/SDL_surface.h"
 #include "SDL3/SDL_video.h"
-#include <SDL3/SDL_rect.h>
-#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "cell.h"
 
-int min(int a, int b) {
-    if (a < b)
-        return a;
-return b;
+typedef struct Color {
+    Uint8 r;
+    Uint8 g;
+    Uint8 b;
+} Color;
+
+static const Color shade_colors[SHADE_LAST] = {
+    [SHADE_BROADLEAVES] = {0, 0, 255},     // blue
+    [SHADE_SHRUBS] = {0, 100, 0},          // dark green
+    [SHADE_GRASSLAND] = {144, 238, 144},   // light green
+    [SHADE_FIREPRONE] = {235, 65, 65},     // red
+    [SHADE_AGROFORESTRY] = {255, 255, 0},  // yellow
+    [SHADE_NOTFIREPRONE] = {138, 138, 138}, // grey
+    [SHADE_BURNT] = {0, 0, 0},
+    [SHADE_ONFIRE] = {255, 0, 0},
+};
+// Around the grid
+static const Color background = {255, 255, 255};
+
+// A cell at most 64 pixels wide
+static constexpr double MIN_CELLS_PER_PIXEL = 1.0 / 64.0;
+static constexpr double ZOOM_STEP = 1.25;
+
+static double fitCellsPerPixel(const SDLState* state, size_t num_rows, size_t num_cols) {
+    const double by_rows = (double)num_rows / state->h;
+    const double by_cols = (double)num_cols / state->w;
+    return by_rows > by_cols ? by_rows : by_cols;
 }
 
-void drawCell(const CellularAutomaton* automaton, size_t row, size_t col, void* userdata) {
-    SDLState* state = userdata;
-    const Cell cell = automaton->rows[row].elements[col];
+void fitView(SDLState* state, size_t num_rows, size_t num_cols) {
+    state->view = (Viewport){
+        .row = 0,
+        .col = 0,
+        .cells_per_pixel = fitCellsPerPixel(state, num_rows, num_cols),
+    };
+}
 
-    int w;
-    int h;
-    if (!SDL_GetWindowSize(state->win, &w, &h)) {
-        SDL_Log("SDL Error, Couldn't get windowsize\nmsg: %s", SDL_GetError());
-        return;
-    }
+/// Scales the cells per pixel by `factor`, keeping the cell under the pixel (x, y) where it is
+static void zoomAt(SDLState* state, double x, double y, double factor, size_t num_rows, size_t num_cols) {
+    Viewport* view = &state->view;
+    const double row = view->row + y * view->cells_per_pixel;
+    const double col = view->col + x * view->cells_per_pixel;
+
+    // Zoomed out until the whole grid is half the window
+    const double max_cells_per_pixel = 2 * fitCellsPerPixel(state, num_rows, num_cols);
+    view->cells_per_pixel = SDL_clamp(view->cells_per_pixel * factor, MIN_CELLS_PER_PIXEL, max_cells_per_pixel);
+    view->row = row - y * view->cells_per_pixel;
+    view->col = col - x * view->cells_per_pixel;
+}
 
-    const int min_size = min(w, h);
-    const int num_cols = (int)automaton->rows[0].count;
-    const int num_rows = (int)automaton->num_rows;
-    const int cell_width = min_size / num_cols;
-    const int cell_height = min_size / num_rows;
-
-    SDL_Rect rect = {
-        .x = cell_width * (int)col,
-        .y = cell_height * (int)row,
-        .w = cell_width,
-        .h = cell_height,
-    };
+bool handleViewEvent(SDLState* state, const SDL_Event* event, size_t num_rows, size_t num_cols) {
+    Viewport* view = &state->view;
 
-    typedef struct Color {
-        Uint8 r;
-        Uint8 g;
-        Uint8 b;
-    } Color;
-    Color c = {0, 0, 0};
-
-    if (cell.state == CELLSTATE_ONFIRE) {
-        c = (Color){255, 0, 0};
-    } else if (cell.state == CELLSTATE_NORMAL) {
-        switch (cell.type) {
-        case VEG_BROADLEAVES:
-            c = (Color){0, 0, 255}; // blue
-            break;
-        case VEG_SHRUBS:
-            c = (Color){0, 100, 0}; // dark green
-            break;
-        case VEG_GRASSLAND:
-            c = (Color){144, 238, 144}; // light green
-            break;
-        case VEG_FIREPRONE:
-            c = (Color){235, 65, 65}; // red
-            break;
-        case VEG_AGROFORESTRY:
-            c = (Color){255, 255, 0}; // yellow
-            break;
-        case VEG_NOTFIREPRONE:
-            c = (Color){138, 138, 138}; // grey
-            break;
+    switch (event->type) {
+    case SDL_EVENT_MOUSE_WHEEL: {
+        const float notches = event->wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? -event->wheel.y : event->wheel.y;
+        if (notches == 0)
+            return false;
+        zoomAt(state, event->wheel.mouse_x, event->wheel.mouse_y, pow(ZOOM_STEP, -notches), num_rows, num_cols);
+        return true;
+    }
+
+    case SDL_EVENT_MOUSE_MOTION:
+        if (!(event->motion.state & (SDL_BUTTON_LMASK | SDL_BUTTON_MMASK)))
+            return false;
+        view->row -= event->motion.yrel * view->cells_per_pixel;
+        view->col -= event->motion.xrel * view->cells_per_pixel;
+        return true;
+
+    case SDL_EVENT_KEY_DOWN: {
+        // The arrow keys move an eighth of the window
+        const double step_rows = state->h / 8.0 * view->cells_per_pixel;
+        const double step_cols = state->w / 8.0 * view->cells_per_pixel;
+        switch (event->key.key) {
+        case SDLK_LEFT:
+            view->col -= step_cols;
+            return true;
+        case SDLK_RIGHT:
+            view->col += step_cols;
+            return true;
+        case SDLK_UP:
+            view->row -= step_rows;
+            return true;
+        case SDLK_DOWN:
+            view->row += step_rows;
+            return true;
+        case SDLK_EQUALS:
+        case SDLK_PLUS:
+        case SDLK_KP_PLUS:
+            zoomAt(state, state->w / 2.0, state->h / 2.0, 1 / ZOOM_STEP, num_rows, num_cols);
+            return true;
+        case SDLK_MINUS:
+        case SDLK_KP_MINUS:
+            zoomAt(state, state->w / 2.0, state->h / 2.0, ZOOM_STEP, num_rows, num_cols);
+            return true;
+        case SDLK_0:
+        case SDLK_HOME:
+            fitView(state, num_rows, num_cols);
+            return true;
         default:
-            assert(false && "Invalid vegtype");
+            return false;
         }
     }
 
-    SDL_FillSurfaceRect(state->surf, &rect, SDL_MapSurfaceRGB(state->surf, c.r, c.g, c.b));
+    default:
+        return false;
+    }
+}
+
+/// Cell under the middle of pixel `pixel`, can be outside of the grid
+static int64_t cellAt(double first, double cells_per_pixel, int pixel) {
+    return (int64_t)floor(first + (pixel + 0.5) * cells_per_pixel);
 }
 
-void display(const SDLState* state, const CellularAutomaton* automaton) {
-    SDL_ClearSurface(state->surf, 1, 1, 1, 1);
+void display(const SDLState* state, const GridPyramid* pyramid) {
+    const Viewport view = state->view;
+    SDL_Surface* frame = state->frame;
+
+    // The finest level where a block is at least a pixel wide
+    size_t level = 0;
+    while (level + 1 < pyramid->num_levels && (double)((size_t)1 << level) < view.cells_per_pixel)
+        level++;
+
+    Uint32 palette[SHADE_LAST];
+    for (size_t shade = 0; shade < SHADE_LAST; shade++)
+        palette[shade] = SDL_MapSurfaceRGB(frame, shade_colors[shade].r, shade_colors[shade].g, shade_colors[shade].b);
+    const Uint32 outside = SDL_MapSurfaceRGB(frame, background.r, background.g, background.b);
+
+    const int64_t num_rows = (int64_t)pyramid->rows[0];
+    const int64_t num_cols = (int64_t)pyramid->cols[0];
+    for (int x = 0; x < state->w; x++) {
+        const int64_t col = cellAt(view.col, view.cells_per_pixel, x);
+        state->columns[x] = col < 0 || col >= num_cols ? SIZE_MAX : (size_t)col >> level;
+    }
+
+    if (SDL_MUSTLOCK(frame) && !SDL_LockSurface(frame)) {
+        SDL_Log("SDL Error, Couldn't lock the frame\nmsg: %s", SDL_GetError());
+        return;
+    }
+
+    for (int y = 0; y < state->h; y++) {
+        Uint32* pixels = (Uint32*)((Uint8*)frame->pixels + (size_t)y * (size_t)frame->pitch);
+        const int64_t row = cellAt(view.row, view.cells_per_pixel, y);
+        if (row < 0 || row >= num_rows) {
+            for (int x = 0; x < state->w; x++)
+                pixels[x] = outside;
+            continue;
+        }
+
+        const uint8_t* blocks = &pyramid->levels[level][((size_t)row >> level) * pyramid->cols[level]];
+        for (int x = 0; x < state->w; x++) {
+            const size_t col = state->columns[x];
+            pixels[x] = col == SIZE_MAX ? outside : palette[blocks[col]];
+        }
+    }
 
-    // Draw the cells
-    forEachCell(automaton, drawCell, (void*)state);
+    if (SDL_MUSTLOCK(frame))
+        SDL_UnlockSurface(frame);
 
+    SDL_BlitSurface(frame, nullptr, state->surf, nullptr);
     SDL_UpdateWindowSurface(state->win);
 }
 
@@ -89,6 +180,9 @@ SDLState initSDL(int w, int h) {
     SDLState res = {
         .win = nullptr,
         .surf = nullptr,
+        .frame = nullptr,
+        .columns = nullptr,
+        .view = {.row = 0, .col = 0, .cells_per_pixel = 1},
         .w = w,
         .h = h,
     };
@@ -113,8 +207,29 @@ SDLState initSDL(int w, int h) {
         return res;
     }
 
+    // 32 bits per pixel, so `display` can write the pixels directly
+    SDL_Surface* frame = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_XRGB8888);
+    if (frame == nullptr) {
+        SDL_Log( "Frame could not be created! SDL error: %s\n", SDL_GetError() );
+        return res;
+    }
+
+    res.columns = malloc((size_t)w * sizeof(size_t));
+    if (!res.columns) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
     res.win = win;
     res.surf = surf;
+    res.frame = frame;
     return res;
 }
 
+void destroySDL(SDLState* state) {
+    free(state->columns);
+    SDL_DestroySurface(state->frame);
+    SDL_DestroySurface(state->surf);
+    SDL_DestroyWindow(state->win);
+    SDL_Quit();
+}
@@ -2,14 +2,40 @@
 
 #include "SDL3/SDL.h"
 #include "cell.h"
+#include "pyramid.h"
+
+/// The part of the grid in the window: the cell at the top left pixel and how many cells wide a pixel is.
+/// Below 1 a cell covers several pixels.
+typedef struct Viewport {
+    double row;
+    double col;
+    double cells_per_pixel;
+} Viewport;
 
 typedef struct SDLState {
     SDL_Window* win;
     SDL_Surface* surf;
+    // Drawn pixel by pixel and then blitted to `surf`, which can be in any format
+    SDL_Surface* frame;
+    // Column of the current level under each pixel column of the frame, SIZE_MAX outside of the grid
+    size_t* columns;
+    Viewport view;
     int w;
     int h;
 } SDLState;
 
 SDLState initSDL(int w, int h);
+void destroySDL(SDLState* state);
+
+/// Zooms and pans so the whole grid fits the window
+void fitView(SDLState* state, size_t num_rows, size_t num_cols);
+
+/// Zooms with the mouse wheel around the pointer, pans with the left or middle mouse button held,
+/// the arrow keys pan, +/- zoom and 0 fits the grid again.
+/// @return Returns true if the view changed and should be drawn again
+bool handleViewEvent(SDLState* state, const SDL_Event* event, size_t num_rows, size_t num_cols);
 
-void display(const SDLState* surface, const CellularAutomaton* automaton);
+/// Draws the view from the finest level of the pyramid whose blocks are at least a pixel wide, so no
+/// block falls between two pixels and a lone burning cell still shows. That is one lookup per pixel
+/// however large the grid is.
+void display(const SDLState* state, const GridPyramid* pyramid);
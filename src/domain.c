@@ -0,0 +1,545 @@
+#include "domain.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "cellbin.h"
+#include "direct_spread.h"
+#include "random.h"
+#include "spotting_spread.h"
+#include "terrain.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum { NEIGHBOUR_UP, NEIGHBOUR_DOWN, NEIGHBOUR_LAST };
+
+/// A firebrand that landed in a neighbour's band, in global coordinates
+typedef struct Firebrand {
+    uint64_t row;
+    uint64_t col;
+} Firebrand;
+
+typedef struct Rank {
+    size_t index;
+    size_t first_row; // global rows [first_row, end_row) are owned by this process
+    size_t end_row;
+    size_t local_offset; // global row of the first local row
+    size_t halo;
+    size_t num_columns;
+    int neighbours[NEIGHBOUR_LAST]; // sockets, -1 at the edges of the grid
+    CellularAutomaton local;        // the band and its halo
+
+    // Reused between steps
+    PackedCell* send_rows[NEIGHBOUR_LAST];
+    PackedCell* recv_rows[NEIGHBOUR_LAST];
+    Firebrand* outbox[NEIGHBOUR_LAST];
+    size_t outbox_count[NEIGHBOUR_LAST];
+    size_t outbox_capacity[NEIGHBOUR_LAST];
+} Rank;
+
+/// One message each way with a neighbour
+typedef struct Transfer {
+    int fd;
+    const uint8_t* send;
+    size_t send_left;
+    uint8_t* recv;
+    size_t recv_left;
+} Transfer;
+
+size_t domainHaloRows(const CellularAutomaton* automaton) {
+    // Direct spread and the burning neighbours of spotting only ever look one row away
+    if (automaton->windY == 0)
+        return 1;
+
+    // The farthest a firebrand flies, with all the turbulence
+    const size_t reach = (size_t)roundf(spottingDistance(automaton->speed) * 1.3f);
+    return reach > 1 ? reach : 1;
+}
+
+/// Sends and receives with all neighbours at once, so neither side blocks on a full socket
+static bool transferAll(Transfer* transfers, size_t count) {
+    for (;;) {
+        struct pollfd fds[NEIGHBOUR_LAST];
+        Transfer* pending[NEIGHBOUR_LAST];
+        nfds_t num_fds = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            Transfer* transfer = &transfers[i];
+            const short events = (short)((transfer->send_left ? POLLOUT : 0) | (transfer->recv_left ? POLLIN : 0));
+            if (!events)
+                continue;
+
+            fds[num_fds] = (struct pollfd) {
+                .fd = transfer->fd,
+                .events = events,
+            };
+            pending[num_fds++] = transfer;
+        }
+        if (num_fds == 0)
+            return true;
+
+        if (poll(fds, num_fds, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return false;
+        }
+
+        for (nfds_t i = 0; i < num_fds; i++) {
+            Transfer* transfer = pending[i];
+            if (fds[i].revents & (POLLERR | POLLNVAL))
+                return false;
+
+            if ((fds[i].revents & POLLOUT) && transfer->send_left) {
+                const ssize_t sent = send(transfer->fd, transfer->send, transfer->send_left, MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (sent < 0 && errno != EAGAIN && errno != EINTR)
+                    return false;
+                if (sent > 0) {
+                    transfer->send += sent;
+                    transfer->send_left -= (size_t)sent;
+                }
+            }
+
+            if ((fds[i].revents & (POLLIN | POLLHUP)) && transfer->recv_left) {
+                const ssize_t received = recv(transfer->fd, transfer->recv, transfer->recv_left, MSG_DONTWAIT);
+                // The neighbour is gone
+                if (received == 0)
+                    return false;
+                if (received < 0 && errno != EAGAIN && errno != EINTR)
+                    return false;
+                if (received > 0) {
+                    transfer->recv += received;
+                    transfer->recv_left -= (size_t)received;
+                }
+            }
+        }
+    }
+}
+
+/// Sends the outermost `rows` rows of the band to the neighbours and puts theirs in the halo
+static bool exchangeHalo(Rank* rank, size_t rows) {
+    const size_t first = rank->first_row - rank->local_offset;
+    const size_t end = rank->end_row - rank->local_offset;
+    const size_t row_bytes = rank->num_columns * sizeof(PackedCell);
+
+    // Rows sent up and down, and the halo rows they fill on the other side
+    const size_t send_first[NEIGHBOUR_LAST] = {first, end - rows};
+    const size_t recv_first[NEIGHBOUR_LAST] = {first - rows, end};
+
+    Transfer transfers[NEIGHBOUR_LAST];
+    size_t count = 0;
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        if (rank->neighbours[side] < 0)
+            continue;
+
+        for (size_t row = 0; row < rows; row++) {
+            const Cell* cells = rank->local.rows[send_first[side] + row].elements;
+            for (size_t col = 0; col < rank->num_columns; col++)
+                rank->send_rows[side][row * rank->num_columns + col] = packCell(&cells[col]);
+        }
+
+        transfers[count++] = (Transfer) {
+            .fd = rank->neighbours[side],
+            .send = (const uint8_t*)rank->send_rows[side],
+            .send_left = rows * row_bytes,
+            .recv = (uint8_t*)rank->recv_rows[side],
+            .recv_left = rows * row_bytes,
+        };
+    }
+
+    if (!transferAll(transfers, count))
+        return false;
+
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        if (rank->neighbours[side] < 0)
+            continue;
+
+        for (size_t row = 0; row < rows; row++) {
+            Cell* cells = rank->local.rows[recv_first[side] + row].elements;
+            for (size_t col = 0; col < rank->num_columns; col++)
+                cells[col] = unpackCell(rank->recv_rows[side][row * rank->num_columns + col]);
+        }
+    }
+    return true;
+}
+
+static void sendFirebrand(Rank* rank, size_t side, size_t row, size_t col) {
+    if (rank->outbox_count[side] == rank->outbox_capacity[side]) {
+        const size_t capacity = rank->outbox_capacity[side] ? rank->outbox_capacity[side] * 2 : 64;
+        Firebrand* outbox = realloc(rank->outbox[side], capacity * sizeof(Firebrand));
+        if (!outbox) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        rank->outbox[side] = outbox;
+        rank->outbox_capacity[side] = capacity;
+    }
+
+    rank->outbox[side][rank->outbox_count[side]++] = (Firebrand) {
+        .row = row,
+        .col = col,
+    };
+}
+
+/// Sends the firebrands that landed in the halo during spotting to the neighbour owning the rows,
+/// and lands the ones the neighbours sent in the band
+static bool exchangeFirebrands(Rank* rank, const CellularAutomaton* before, CellularAutomaton* after) {
+    const size_t first = rank->first_row - rank->local_offset;
+    const size_t end = rank->end_row - rank->local_offset;
+    const size_t halo_first[NEIGHBOUR_LAST] = {0, end};
+    const size_t halo_end[NEIGHBOUR_LAST] = {first, after->num_rows};
+
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        rank->outbox_count[side] = 0;
+        for (size_t row = halo_first[side]; row < halo_end[side]; row++) {
+            const Cell* was = before->rows[row].elements;
+            const Cell* is = after->rows[row].elements;
+            for (size_t col = 0; col < rank->num_columns; col++) {
+                if (is[col].state == CELLSTATE_ONFIRE && was[col].state != CELLSTATE_ONFIRE)
+                    sendFirebrand(rank, side, row + rank->local_offset, col);
+            }
+        }
+    }
+
+    // The counts first, then the firebrands themselves
+    uint64_t send_counts[NEIGHBOUR_LAST];
+    uint64_t recv_counts[NEIGHBOUR_LAST] = {0, 0};
+    Transfer transfers[NEIGHBOUR_LAST];
+    size_t count = 0;
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        if (rank->neighbours[side] < 0)
+            continue;
+
+        send_counts[side] = rank->outbox_count[side];
+        transfers[count++] = (Transfer) {
+            .fd = rank->neighbours[side],
+            .send = (const uint8_t*)&send_counts[side],
+            .send_left = sizeof(uint64_t),
+            .recv = (uint8_t*)&recv_counts[side],
+            .recv_left = sizeof(uint64_t),
+        };
+    }
+    if (!transferAll(transfers, count))
+        return false;
+
+    Firebrand* inbox[NEIGHBOUR_LAST] = {nullptr, nullptr};
+    count = 0;
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        if (rank->neighbours[side] < 0)
+            continue;
+
+        inbox[side] = malloc((recv_counts[side] ? recv_counts[side] : 1) * sizeof(Firebrand));
+        if (!inbox[side]) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        transfers[count++] = (Transfer) {
+            .fd = rank->neighbours[side],
+            .send = (const uint8_t*)rank->outbox[side],
+            .send_left = rank->outbox_count[side] * sizeof(Firebrand),
+            .recv = (uint8_t*)inbox[side],
+            .recv_left = recv_counts[side] * sizeof(Firebrand),
+        };
+    }
+
+    bool ok = transferAll(transfers, count);
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        for (size_t i = 0; ok && i < recv_counts[side]; i++) {
+            const Firebrand firebrand = inbox[side][i];
+            // The sender checked the cell against its copy of the halo, which is this step's band
+            if (firebrand.row < rank->first_row || firebrand.row >= rank->end_row || firebrand.col >= rank->num_columns) {
+                fprintf(stderr, "Process %zu got a firebrand outside its band\n", rank->index);
+                ok = false;
+                break;
+            }
+            after->rows[firebrand.row - rank->local_offset].elements[firebrand.col].state = CELLSTATE_ONFIRE;
+        }
+        free(inbox[side]);
+    }
+    return ok;
+}
+
+static bool stepRank(Rank* rank) {
+    const size_t first = rank->first_row - rank->local_offset;
+    const size_t end = rank->end_row - rank->local_offset;
+
+    // Direct spread only needs the row next to the band
+    if (!exchangeHalo(rank, 1))
+        return false;
+    CellularAutomaton spread = directSpread(&rank->local);
+    destroyAutomaton(&rank->local);
+    rank->local = spread;
+
+    // Spotting checks where the firebrands land against this step's direct spread
+    if (!exchangeHalo(rank, rank->halo))
+        return false;
+    CellularAutomaton spotted = spottingSpreadRows(&rank->local, first, end);
+    const bool ok = exchangeFirebrands(rank, &rank->local, &spotted);
+    destroyAutomaton(&rank->local);
+
+    rank->local = burnoutCells(&spotted);
+    destroyAutomaton(&spotted);
+    return ok;
+}
+
+/// Copies the band and its halo out of the full grid
+static CellularAutomaton sliceAutomaton(const CellularAutomaton* automaton, size_t first_row, size_t end_row) {
+    const size_t num_rows = end_row - first_row;
+    const size_t num_columns = automaton->rows[0].count;
+
+    CellularAutomaton slice = *automaton;
+    slice.num_rows = num_rows;
+    slice.burnout = nullptr;
+    slice.arena = nullptr;
+    slice.rows = malloc(num_rows * sizeof(CellArray));
+    Cell* cells = malloc(num_rows * num_columns * sizeof(Cell));
+    if (!slice.rows || !cells) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t row = 0; row < num_rows; row++) {
+        slice.rows[row] = (CellArray) {
+            .count = num_columns,
+            .elements = cells + row * num_columns,
+        };
+        memcpy(slice.rows[row].elements, automaton->rows[first_row + row].elements, num_columns * sizeof(Cell));
+    }
+
+    // The slope factors of the rows at the edge of the slice are off, but they only matter towards rows outside of it
+    if (automaton->terrain) {
+        const Terrain* terrain = automaton->terrain;
+        float* elevation = malloc(num_rows * num_columns * sizeof(float));
+        if (!elevation) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(elevation, terrain->elevation + first_row * num_columns, num_rows * num_columns * sizeof(float));
+        slice.terrain = createTerrain(elevation, num_rows, num_columns, terrain->cell_size);
+    }
+
+    return slice;
+}
+
+static void allocateRankBuffers(Rank* rank) {
+    for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+        rank->send_rows[side] = malloc(rank->halo * rank->num_columns * sizeof(PackedCell));
+        rank->recv_rows[side] = malloc(rank->halo * rank->num_columns * sizeof(PackedCell));
+        rank->outbox[side] = nullptr;
+        rank->outbox_count[side] = 0;
+        rank->outbox_capacity[side] = 0;
+        if (!rank->send_rows[side] || !rank->recv_rows[side]) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static bool writeAll(int fd, const void* data, size_t bytes) {
+    const uint8_t* bytes_left = data;
+    while (bytes > 0) {
+        const ssize_t written = write(fd, bytes_left, bytes);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes_left += written;
+        bytes -= (size_t)written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t bytes) {
+    uint8_t* bytes_left = data;
+    while (bytes > 0) {
+        const ssize_t received = read(fd, bytes_left, bytes);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        bytes_left += received;
+        bytes -= (size_t)received;
+    }
+    return true;
+}
+
+/// What each forked process runs, it exits instead of returning
+static void rankMain(Rank* rank, const CellularAutomaton* automaton, size_t steps, uint64_t seed, int result_fd) {
+    seedSimulation(seed * 0x9E3779B97F4A7C15ull + rank->index);
+
+    const size_t num_rows = automaton->num_rows;
+    rank->local_offset = rank->first_row > rank->halo ? rank->first_row - rank->halo : 0;
+    const size_t local_end = rank->end_row + rank->halo < num_rows ? rank->end_row + rank->halo : num_rows;
+    rank->local = sliceAutomaton(automaton, rank->local_offset, local_end);
+    allocateRankBuffers(rank);
+
+    bool ok = true;
+    for (size_t step = 0; ok && step < steps; step++)
+        ok = stepRank(rank);
+
+    // The band goes back to the parent, packed like it went to the neighbours
+    PackedCell* row = malloc(rank->num_columns * sizeof(PackedCell));
+    if (!row) {
+        fprintf(stderr, "Out Of Memory\n");
+        _exit(EXIT_FAILURE);
+    }
+    for (size_t global_row = rank->first_row; ok && global_row < rank->end_row; global_row++) {
+        const Cell* cells = rank->local.rows[global_row - rank->local_offset].elements;
+        for (size_t col = 0; col < rank->num_columns; col++)
+            row[col] = packCell(&cells[col]);
+        ok = writeAll(result_fd, row, rank->num_columns * sizeof(PackedCell));
+    }
+
+    if (!ok)
+        fprintf(stderr, "Process %zu lost its neighbours\n", rank->index);
+    _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+bool runDecomposed(const CellularAutomaton* automaton, size_t num_processes, size_t steps, uint64_t seed,
+                   CellularAutomaton* result) {
+    if (automaton->wind) {
+        fputs("ERROR: a wind field can't be split over processes\n", stderr);
+        return false;
+    }
+
+    const size_t num_rows = automaton->num_rows;
+    const size_t halo = domainHaloRows(automaton);
+    // Firebrands may only land in the neighbouring bands
+    if (num_processes > num_rows / halo)
+        num_processes = num_rows / halo;
+    if (num_processes == 0)
+        num_processes = 1;
+
+    Rank* ranks = calloc(num_processes, sizeof(Rank));
+    pid_t* pids = calloc(num_processes, sizeof(pid_t));
+    int* result_fds = malloc(num_processes * sizeof(int));
+    if (!ranks || !pids || !result_fds) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t index = 0; index < num_processes; index++) {
+        ranks[index] = (Rank) {
+            .index = index,
+            .first_row = index * num_rows / num_processes,
+            .end_row = (index + 1) * num_rows / num_processes,
+            .halo = halo,
+            .num_columns = automaton->rows[0].count,
+            .neighbours = {-1, -1},
+        };
+        result_fds[index] = -1;
+    }
+
+    bool ok = true;
+    for (size_t index = 0; ok && index + 1 < num_processes; index++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            perror("socketpair");
+            ok = false;
+            break;
+        }
+        ranks[index].neighbours[NEIGHBOUR_DOWN] = pair[0];
+        ranks[index + 1].neighbours[NEIGHBOUR_UP] = pair[1];
+    }
+
+    // Anything buffered would be written by every child as well
+    fflush(stdout);
+    fflush(stderr);
+
+    size_t started = 0;
+    for (; ok && started < num_processes; started++) {
+        int result_pipe[2];
+        if (pipe(result_pipe) != 0) {
+            perror("pipe");
+            ok = false;
+            break;
+        }
+
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            close(result_pipe[0]);
+            close(result_pipe[1]);
+            ok = false;
+            break;
+        }
+
+        if (pid == 0) {
+            // Only keep the sockets of this process
+            close(result_pipe[0]);
+            for (size_t other = 0; other < started; other++)
+                close(result_fds[other]);
+            for (size_t other = 0; other < num_processes; other++) {
+                if (other == started)
+                    continue;
+                for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+                    if (ranks[other].neighbours[side] >= 0)
+                        close(ranks[other].neighbours[side]);
+                }
+            }
+            rankMain(&ranks[started], automaton, steps, seed, result_pipe[1]);
+        }
+
+        close(result_pipe[1]);
+        result_fds[started] = result_pipe[0];
+        pids[started] = pid;
+    }
+
+    // The neighbours talk among themselves, the parent only waits for the bands
+    for (size_t index = 0; index < num_processes; index++) {
+        for (size_t side = 0; side < NEIGHBOUR_LAST; side++) {
+            if (ranks[index].neighbours[side] >= 0)
+                close(ranks[index].neighbours[side]);
+        }
+    }
+
+    const bool has_result = ok;
+    if (has_result) {
+        // A plain copy, whatever the arena and burnout wheel of the original are doing
+        CellularAutomaton plain = *automaton;
+        plain.burnout = nullptr;
+        plain.arena = nullptr;
+        *result = cloneAutomaton(&plain);
+        result->step = automaton->step + steps;
+    }
+
+    const size_t num_columns = automaton->rows[0].count;
+    PackedCell* row = malloc(num_columns * sizeof(PackedCell));
+    if (!row) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t index = 0; index < started; index++) {
+        for (size_t global_row = ranks[index].first_row; ok && global_row < ranks[index].end_row; global_row++) {
+            ok = readAll(result_fds[index], row, num_columns * sizeof(PackedCell));
+            for (size_t col = 0; ok && col < num_columns; col++)
+                result->rows[global_row].elements[col] = unpackCell(row[col]);
+        }
+        close(result_fds[index]);
+    }
+    free(row);
+
+    for (size_t index = 0; index < started; index++) {
+        int status;
+        if (waitpid(pids[index], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            ok = false;
+    }
+
+    if (!ok) {
+        fputs("ERROR: the decomposed simulation failed\n", stderr);
+        if (has_result)
+            destroyAutomaton(result);
+    }
+
+    free(ranks);
+    free(pids);
+    free(result_fds);
+    return ok;
+}
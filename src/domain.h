@@ -0,0 +1,25 @@
+#pragma once
+#include "cell.h"
+#include <stdint.h>
+
+/*
+ * Domain decomposition over several processes.
+ *
+ * The grid is split into bands of rows, one per process. Every process keeps a halo of its
+ * neighbours' rows around its band and swaps it with them over a local socket twice a step:
+ * one row before direct spread, and a firebrand reach of rows after it, so spotting sees the same
+ * cells it would in one process. Firebrands landing in a neighbour's band are sent to it as messages.
+ * Each step still runs `directSpread`, `spottingSpreadRows` and `burnoutCells`, on the band with its halo.
+ *
+ * The processes are forked from the caller, which collects the bands when they are done.
+ * Every process seeds its generator differently, so the result matches one process in distribution.
+ * The terrain is supported, a wind field isn't.
+ */
+
+/// Rows of halo a band needs on each side, which is also the smallest band there can be
+size_t domainHaloRows(const CellularAutomaton* automaton);
+
+/// Runs `steps` steps of the automaton on `num_processes` processes, at most one per `domainHaloRows` rows.
+/// On success `result` is a new automaton with the final state, destroy it with `destroyAutomaton`.
+bool runDecomposed(const CellularAutomaton* automaton, size_t num_processes, size_t steps, uint64_t seed,
+                   CellularAutomaton* result);
@@ -0,0 +1,402 @@
+#include "exposure.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "direct_spread.h"
+#include "random.h"
+#include "spotting_spread.h"
+#include "terrain.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Cell ignited by a firebrand in the current step, not burning until the spotting is done
+#define EXPOSURE_SPOTTED 'S'
+
+static const VegType veg_types[VEG_LAST] = {
+    VEG_BROADLEAVES, VEG_SHRUBS, VEG_GRASSLAND, VEG_FIREPRONE, VEG_AGROFORESTRY, VEG_NOTFIREPRONE,
+};
+
+/// The parts of the automaton the fires read, packed and shared by every thread
+typedef struct ExposureGrid {
+    uint8_t* states;   // CELLSTATE_NORMAL, or CELLSTATE_BURNT for the cells that can't ignite
+    uint8_t* veg;      // `vegTypeIndex` of every cell
+    float* moisture;
+    size_t num_rows;
+    size_t num_columns;
+    const Terrain* terrain;
+    int windX;
+    int windY;
+    WindSpeed speed;
+    float a_w[8];      // ordered by `neighbourIndex`
+    float chances[8][VEG_LAST][VEG_LAST]; // chance to spread on flat terrain, before the moisture
+    size_t durations[VEG_LAST];
+} ExposureGrid;
+
+typedef struct BurningCell {
+    size_t index;
+    size_t burnout_step;
+} BurningCell;
+
+/// One thread and the state of the fire it is simulating
+typedef struct ExposureWorker {
+    struct Exposure* exposure;
+    pthread_t thread;
+    uint8_t* states;       // copy of the grid states, put back after every fire
+    size_t* touched;       // every cell the current fire ignited
+    size_t num_touched;
+    size_t touched_capacity;
+    BurningCell* burning;
+    size_t num_burning;
+    size_t burning_capacity;
+    ExposureStats stats;
+} ExposureWorker;
+
+typedef struct Exposure {
+    const ExposureGrid* grid;
+    const ExposureOptions* options;
+    float* result;
+    pthread_mutex_t lock;
+    size_t next; // rows, or the entries of `options->cells`, are handed out one at a time under `lock`
+} Exposure;
+
+static void igniteExposureCell(ExposureWorker* worker, size_t index, uint8_t state, size_t step) {
+    const ExposureGrid* grid = worker->exposure->grid;
+    worker->states[index] = state;
+
+    if (worker->num_touched == worker->touched_capacity) {
+        worker->touched_capacity = worker->touched_capacity ? worker->touched_capacity * 2 : 256;
+        worker->touched = realloc(worker->touched, worker->touched_capacity * sizeof(size_t));
+    }
+    if (worker->num_burning == worker->burning_capacity) {
+        worker->burning_capacity = worker->burning_capacity ? worker->burning_capacity * 2 : 256;
+        worker->burning = realloc(worker->burning, worker->burning_capacity * sizeof(BurningCell));
+    }
+    if (!worker->touched || !worker->burning) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    worker->touched[worker->num_touched++] = index;
+    // Same step as `scheduleBurnout` would put it in
+    worker->burning[worker->num_burning++] = (BurningCell) {
+        .index = index,
+        .burnout_step = step + grid->durations[grid->veg[index]],
+    };
+}
+
+static void spreadFromExposureCell(ExposureWorker* worker, size_t index, size_t step) {
+    const ExposureGrid* grid = worker->exposure->grid;
+    const size_t row = index / grid->num_columns;
+    const size_t col = index % grid->num_columns;
+    const uint8_t src_veg = grid->veg[index];
+
+    for (int dy = -1; dy <= 1; dy++) {
+        if ((dy < 0 && row == 0) || (dy > 0 && row + 1 >= grid->num_rows))
+            continue;
+
+        for (int dx = -1; dx <= 1; dx++) {
+            if (dx == 0 && dy == 0)
+                continue;
+            if ((dx < 0 && col == 0) || (dx > 0 && col + 1 >= grid->num_columns))
+                continue;
+
+            const size_t dst = (size_t)((ptrdiff_t)index + dy * (ptrdiff_t)grid->num_columns + dx);
+            // Cells ignited earlier in this step are skipped here, where `directSpread` draws for them and
+            // then finds them burning in its output, the chance they end up burning is the same
+            if (worker->states[dst] != CELLSTATE_NORMAL)
+                continue;
+
+            const size_t direction = neighbourIndex(dx, dy);
+            float chance;
+            if (grid->terrain) {
+                const Cell src_cell = {.type = veg_types[src_veg]};
+                const Cell dst_cell = {.type = veg_types[grid->veg[dst]], .moisture = grid->moisture[dst]};
+                chance = chanceToSpread(&src_cell, &dst_cell, grid->a_w[direction], slopeFactor(grid->terrain, row, col, dx, dy));
+            } else {
+                chance = grid->chances[direction][grid->veg[dst]][src_veg] * (1 - grid->moisture[dst]);
+            }
+
+            if (simulationRandom() < chance)
+                igniteExposureCell(worker, dst, CELLSTATE_ONFIRE, step);
+        }
+    }
+}
+
+/// Burning cells around the firebrand thrower, as `firebrandChance` counts them
+static unsigned int countFirebrandNeighbours(const ExposureWorker* worker, size_t row, size_t col) {
+    const ExposureGrid* grid = worker->exposure->grid;
+    // Its neighbour loops start at row - 1 and col - 1, which wrap around at 0
+    if (row == 0 || col == 0)
+        return 0;
+
+    // It looks at the cell's own column once for every neighbour column
+    const unsigned int columns = col + 1 < grid->num_columns ? 3 : 2;
+    unsigned int burning = 0;
+    for (size_t neighbour_row = row - 1; neighbour_row <= row + 1 && neighbour_row < grid->num_rows; neighbour_row++)
+        burning += worker->states[neighbour_row * grid->num_columns + col] == CELLSTATE_ONFIRE;
+    return burning * columns;
+}
+
+static void throwExposureFirebrand(ExposureWorker* worker, size_t index, size_t step) {
+    const ExposureGrid* grid = worker->exposure->grid;
+    const size_t row = index / grid->num_columns;
+    const size_t col = index % grid->num_columns;
+
+    const unsigned int burning_neighbours = countFirebrandNeighbours(worker, row, col);
+    if (simulationRandom() >= firebrandChanceFromCount(burning_neighbours, grid->speed, grid->moisture[index]))
+        return;
+
+    // Same distance and turbulence as `spottingSpread`
+    const float distance = spottingDistance(grid->speed);
+    const float total_distance = distance + distance * 0.3f * (simulationRandom() - 0.5f) * 2.0f;
+    const int dst_col = (int)col + (int)roundf(total_distance) * grid->windX;
+    const int dst_row = (int)row + (int)roundf(total_distance) * grid->windY;
+    if (dst_col < 0 || dst_col >= (int)grid->num_columns || dst_row < 0 || dst_row >= (int)grid->num_rows)
+        return;
+
+    const size_t dst = (size_t)dst_row * grid->num_columns + (size_t)dst_col;
+    if (worker->states[dst] != CELLSTATE_NORMAL)
+        return;
+
+    const Cell dst_cell = {.type = veg_types[grid->veg[dst]], .moisture = grid->moisture[dst]};
+    if (simulationRandom() < ignitionSpotting(total_distance, &dst_cell))
+        igniteExposureCell(worker, dst, EXPOSURE_SPOTTED, step);
+}
+
+/// Runs one fire from `start`, returns the number of cells it burnt
+static size_t runExposureFire(ExposureWorker* worker, size_t start) {
+    const size_t max_steps = worker->exposure->options->max_steps;
+
+    size_t step = 0;
+    igniteExposureCell(worker, start, CELLSTATE_ONFIRE, step);
+    while (worker->num_burning > 0 && step < max_steps) {
+        // Only the cells that burned at the start of the step spread directly
+        const size_t burning_before = worker->num_burning;
+        for (size_t cell = 0; cell < burning_before; cell++)
+            spreadFromExposureCell(worker, worker->burning[cell].index, step);
+
+        // The cells that just ignited throw firebrands as well, the spotted ones only from the next step
+        const size_t burning_after_direct = worker->num_burning;
+        for (size_t cell = 0; cell < burning_after_direct; cell++)
+            throwExposureFirebrand(worker, worker->burning[cell].index, step);
+        for (size_t cell = burning_after_direct; cell < worker->num_burning; cell++)
+            worker->states[worker->burning[cell].index] = CELLSTATE_ONFIRE;
+
+        // Burnout, keeping the cells that are still burning at the front
+        size_t kept = 0;
+        for (size_t cell = 0; cell < worker->num_burning; cell++) {
+            const BurningCell burning = worker->burning[cell];
+            if (burning.burnout_step == step)
+                worker->states[burning.index] = CELLSTATE_BURNT;
+            else
+                worker->burning[kept++] = burning;
+        }
+        worker->num_burning = kept;
+        step++;
+    }
+
+    worker->stats.fires++;
+    worker->stats.steps += step;
+    worker->stats.cut_off += worker->num_burning > 0;
+
+    // Put the grid back the way the next fire expects it, every cell touched was unburnt
+    const size_t burnt = worker->num_touched;
+    for (size_t cell = 0; cell < worker->num_touched; cell++)
+        worker->states[worker->touched[cell]] = CELLSTATE_NORMAL;
+    worker->num_touched = 0;
+    worker->num_burning = 0;
+    return burnt;
+}
+
+static void exposeCell(ExposureWorker* worker, size_t index) {
+    Exposure* exposure = worker->exposure;
+    const ExposureOptions* options = exposure->options;
+    if (exposure->grid->states[index] != CELLSTATE_NORMAL) {
+        exposure->result[index] = 0.0f;
+        return;
+    }
+
+    size_t burnt = 0;
+    for (size_t realization = 0; realization < options->realizations; realization++) {
+        // Seeded by cell and realization, so the raster doesn't depend on the number of threads
+        seedSimulation(options->seed * 0x100000001B3ull + index * options->realizations + realization);
+        burnt += runExposureFire(worker, index);
+    }
+    exposure->result[index] = (float)((double)burnt / (double)options->realizations);
+}
+
+static void* exposureWorkerMain(void* userdata) {
+    ExposureWorker* worker = userdata;
+    Exposure* exposure = worker->exposure;
+    const ExposureGrid* grid = exposure->grid;
+    const ExposureOptions* options = exposure->options;
+
+    for (;;) {
+        pthread_mutex_lock(&exposure->lock);
+        const size_t next = exposure->next++;
+        pthread_mutex_unlock(&exposure->lock);
+
+        if (options->cells) {
+            if (next >= options->num_cells)
+                break;
+            exposeCell(worker, options->cells[next]);
+        } else {
+            if (next >= grid->num_rows)
+                break;
+            for (size_t col = 0; col < grid->num_columns; col++)
+                exposeCell(worker, next * grid->num_columns + col);
+        }
+    }
+    return nullptr;
+}
+
+static ExposureGrid packExposureGrid(const CellularAutomaton* automaton) {
+    const size_t num_columns = automaton->rows[0].count;
+    const size_t num_cells = automaton->num_rows * num_columns;
+    ExposureGrid grid = {
+        .states = malloc(num_cells),
+        .veg = malloc(num_cells),
+        .moisture = malloc(num_cells * sizeof(float)),
+        .num_rows = automaton->num_rows,
+        .num_columns = num_columns,
+        .terrain = automaton->terrain,
+        .windX = automaton->windX,
+        .windY = automaton->windY,
+        .speed = automaton->speed,
+    };
+    if (!grid.states || !grid.veg || !grid.moisture) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t row = 0; row < automaton->num_rows; row++) {
+        for (size_t col = 0; col < num_columns; col++) {
+            const Cell* cell = &automaton->rows[row].elements[col];
+            const size_t index = row * num_columns + col;
+            grid.states[index] = cell->state == CELLSTATE_BURNT ? CELLSTATE_BURNT : CELLSTATE_NORMAL;
+            grid.veg[index] = (uint8_t)vegTypeIndex(cell->type);
+            grid.moisture[index] = cell->moisture;
+        }
+    }
+
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (dx == 0 && dy == 0)
+                continue;
+            grid.a_w[neighbourIndex(dx, dy)] = windFactor(grid.windX, grid.windY, grid.speed, dx, dy);
+        }
+    }
+
+    // Same table as the specialized `directSpread` kernels build
+    for (size_t direction = 0; direction < 8; direction++) {
+        for (size_t dst = 0; dst < VEG_LAST; dst++) {
+            for (size_t src = 0; src < VEG_LAST; src++) {
+                const Cell src_cell = {.type = veg_types[src]};
+                const Cell dst_cell = {.type = veg_types[dst]};
+                grid.chances[direction][dst][src] = chanceToSpread(&src_cell, &dst_cell, grid.a_w[direction], 1.0f);
+            }
+        }
+    }
+
+    for (size_t veg = 0; veg < VEG_LAST; veg++)
+        grid.durations[veg] = burnDuration(veg_types[veg]);
+    return grid;
+}
+
+float* computeExposure(const CellularAutomaton* automaton, const ExposureOptions* options, ExposureStats* stats) {
+    if (automaton->wind) {
+        fprintf(stderr, "ERROR: exposure needs the same wind everywhere, not a wind field\n");
+        return nullptr;
+    }
+
+    size_t num_threads = options->num_threads;
+    if (num_threads == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t)online : 1;
+    }
+
+    const size_t num_cells = automaton->num_rows * automaton->rows[0].count;
+    for (size_t cell = 0; options->cells && cell < options->num_cells; cell++) {
+        if (options->cells[cell] >= num_cells) {
+            fprintf(stderr, "ERROR: exposure cell %zu is outside of the grid\n", options->cells[cell]);
+            return nullptr;
+        }
+    }
+
+    const ExposureGrid grid = packExposureGrid(automaton);
+    Exposure exposure = {
+        .grid = &grid,
+        .options = options,
+        // The cells left out stay 0
+        .result = options->cells ? calloc(num_cells, sizeof(float)) : malloc(num_cells * sizeof(float)),
+        .next = 0,
+    };
+    ExposureWorker* workers = calloc(num_threads, sizeof(ExposureWorker));
+    if (!exposure.result || !workers) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&exposure.lock, nullptr);
+
+    for (size_t index = 0; index < num_threads; index++) {
+        workers[index].exposure = &exposure;
+        workers[index].states = malloc(num_cells);
+        if (!workers[index].states) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(workers[index].states, grid.states, num_cells);
+    }
+
+    size_t started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&workers[started].thread, nullptr, exposureWorkerMain, &workers[started]) != 0) {
+            fprintf(stderr, "Failed to start worker thread %zu\n", started);
+            break;
+        }
+    }
+    // The threads that did start take the rows of the others
+    if (started == 0)
+        exposureWorkerMain(&workers[0]);
+    for (size_t index = 0; index < started; index++)
+        pthread_join(workers[index].thread, nullptr);
+
+    if (stats)
+        *stats = (ExposureStats) {0};
+    for (size_t index = 0; index < num_threads; index++) {
+        if (stats) {
+            stats->fires += workers[index].stats.fires;
+            stats->steps += workers[index].stats.steps;
+            stats->cut_off += workers[index].stats.cut_off;
+        }
+        free(workers[index].states);
+        free(workers[index].touched);
+        free(workers[index].burning);
+    }
+    free(workers);
+    pthread_mutex_destroy(&exposure.lock);
+
+    free(grid.states);
+    free(grid.veg);
+    free(grid.moisture);
+    return exposure.result;
+}
+
+bool writeExposureRaster(const char* path, const float* exposure, size_t num_rows, size_t num_columns) {
+    FILE* fd = fopen(path, "w");
+    if (!fd) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return false;
+    }
+
+    for (size_t row = 0; row < num_rows; row++) {
+        for (size_t col = 0; col < num_columns; col++)
+            fprintf(fd, "%g,", (double)exposure[row * num_columns + col]);
+        fputc('\n', fd);
+    }
+    return fclose(fd) == 0;
+}
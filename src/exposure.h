@@ -0,0 +1,38 @@
+#pragma once
+#include "cell.h"
+#include <stdint.h>
+
+/*
+ * Ignition exposure, the expected number of cells burnt by a fire that starts in a given cell.
+ *
+ * That is one small simulation per cell and realization, far too many to clone the grid for each.
+ * The grid is packed once into a read-only copy shared by every thread, and each thread keeps a
+ * byte of state per cell plus the list of the cells burning in its current fire. A step only visits
+ * the burning cells and a fire ends as soon as nothing burns, so a fire that dies out after a few
+ * cells costs a few cells, whatever the size of the grid. The steps follow `directSpread`,
+ * `spottingSpread` and `burnoutCells`, though the random numbers are drawn in a different order.
+ */
+
+typedef struct ExposureOptions {
+    size_t realizations; // fires started in every cell
+    size_t max_steps;    // fires still burning after this many steps are cut off
+    uint64_t seed;
+    size_t num_threads;  // 0 for one per CPU
+    const size_t* cells; // row * num_columns + col of the only cells to start fires in, null for every cell
+    size_t num_cells;
+} ExposureOptions;
+
+typedef struct ExposureStats {
+    size_t fires;
+    size_t steps;     // summed over all fires
+    size_t cut_off;   // fires still burning after `max_steps`
+} ExposureStats;
+
+/// Mean number of cells burnt by a fire started in each cell, row by row, free it with `free`.
+/// The fires already burning in the automaton are ignored, cells burnt in it stay burnt and get 0,
+/// as do the cells left out of `options->cells`.
+/// Returns null if the automaton has a wind field, the wind has to be the same everywhere.
+float* computeExposure(const CellularAutomaton* automaton, const ExposureOptions* options, ExposureStats* stats);
+
+/// Writes the raster as text, one line per row with a ',' after every value
+bool writeExposureRaster(const char* path, const float* exposure, size_t num_rows, size_t num_columns);
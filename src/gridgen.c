@@ -0,0 +1,531 @@
+#define _GNU_SOURCE // pwrite
+#include "gridgen.h"
+#include "cell.h"
+#include "cellbin.h"
+#include "random.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Rows a thread generates and writes at a time
+#define GRIDGEN_CHUNK_CELLS (1u << 20)
+
+// Lengths of a text cell, "N,G,065,\n" and "N,G,065,-00012,\n"
+#define CELL_TEXT_BYTES 9
+#define CELL_TEXT_ELEVATION_BYTES 16
+// The elevation has 5 digits and a sign
+#define MAX_ELEVATION 99999
+
+typedef struct Strip {
+    bool vertical;   // runs from the top to the bottom, else from the left to the right
+    bool river;      // soaked, else a firebreak at the local moisture
+    float half_width;
+    float* centers;  // column (or row) of the middle, for every row (or column)
+    float lowest;    // the range of `centers`, to skip the rows a horizontal strip is far from
+    float highest;
+} Strip;
+
+typedef struct GridGen {
+    const GridGenOptions* options;
+    Strip* strips;
+    size_t num_strips;
+    GridGenIgnition* ignitions; // the given ones and the random ones
+    size_t num_ignitions;
+    int text_fd;                // -1 for no text
+    int bin_fd;                 // -1 for no .cellbin
+    size_t text_header_bytes;
+    size_t text_cell_bytes;
+    size_t rows_per_chunk;
+    pthread_mutex_t lock;
+    size_t next_row;
+    bool failed;
+} GridGen;
+
+static uint64_t hashLattice(uint64_t seed, int64_t x, int64_t y) {
+    uint64_t z = seed ^ ((uint64_t)x * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)y * 0xC2B2AE3D27D4EB4Full);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static float latticeValue(uint64_t seed, int64_t x, int64_t y) {
+    return (float)(hashLattice(seed, x, y) >> 40) * (1.0f / 16777216.0f);
+}
+
+static float smooth(float t) {
+    return t * t * (3.0f - 2.0f * t);
+}
+
+/// Value noise between 0 and 1 with one lattice point every `1 / frequency` cells
+static float valueNoise(uint64_t seed, float x, float y) {
+    const float fx = floorf(x);
+    const float fy = floorf(y);
+    const int64_t ix = (int64_t)fx;
+    const int64_t iy = (int64_t)fy;
+    const float tx = smooth(x - fx);
+    const float ty = smooth(y - fy);
+
+    const float top = latticeValue(seed, ix, iy) + (latticeValue(seed, ix + 1, iy) - latticeValue(seed, ix, iy)) * tx;
+    const float bottom = latticeValue(seed, ix, iy + 1) + (latticeValue(seed, ix + 1, iy + 1) - latticeValue(seed, ix, iy + 1)) * tx;
+    return top + (bottom - top) * ty;
+}
+
+/// Sum of `octaves` layers of noise, each twice as fine and half as strong, between 0 and 1
+static float fractalNoise(uint64_t seed, float x, float y, int octaves) {
+    float sum = 0.0f;
+    float amplitude = 0.5f;
+    float total = 0.0f;
+    for (int octave = 0; octave < octaves; octave++) {
+        sum += amplitude * valueNoise(seed + (uint64_t)octave, x, y);
+        total += amplitude;
+        x *= 2.0f;
+        y *= 2.0f;
+        amplitude *= 0.5f;
+    }
+    return sum / total;
+}
+
+static VegType fuelAt(float noise) {
+    // Grass and shrubs in the open, forest in the middle, the most fire prone stands on top.
+    // The noise bunches up around 0.5, these split it into about 20, 25, 25, 15 and 15 percent.
+    if (noise < 0.36f)
+        return VEG_GRASSLAND;
+    if (noise < 0.48f)
+        return VEG_SHRUBS;
+    if (noise < 0.575f)
+        return VEG_BROADLEAVES;
+    if (noise < 0.645f)
+        return VEG_AGROFORESTRY;
+    return VEG_FIREPRONE;
+}
+
+/// Adds `octaves` layers of `fractalNoise` along row `y` to `out`, scaled by `scale`.
+/// Bilinear interpolation splits into going down and then across, so each layer interpolates
+/// its lattice columns down to the row once and every cell only interpolates across.
+static void addNoiseRow(float* out, size_t width, uint64_t seed, float frequency, float y, int octaves,
+                        float scale, float* lattice) {
+    float amplitude = 0.5f;
+    float total = 0.0f;
+    for (int octave = 0; octave < octaves; octave++)
+        total += amplitude / (float)(1 << octave);
+    amplitude = scale * 0.5f / total;
+
+    for (int octave = 0; octave < octaves; octave++) {
+        const uint64_t octave_seed = seed + (uint64_t)octave;
+        const float fy = floorf(y);
+        const int64_t iy = (int64_t)fy;
+        const float ty = smooth(y - fy);
+
+        const size_t num_lattice = (size_t)((float)(width - 1) * frequency) + 2;
+        for (size_t ix = 0; ix < num_lattice; ix++) {
+            const float top = latticeValue(octave_seed, (int64_t)ix, iy);
+            lattice[ix] = top + (latticeValue(octave_seed, (int64_t)ix, iy + 1) - top) * ty;
+        }
+
+        for (size_t col = 0; col < width; col++) {
+            const float x = (float)col * frequency;
+            const float fx = floorf(x);
+            const size_t ix = (size_t)fx;
+            out[col] += amplitude * (lattice[ix] + (lattice[ix + 1] - lattice[ix]) * smooth(x - fx));
+        }
+
+        y *= 2.0f;
+        frequency *= 2.0f;
+        amplitude *= 0.5f;
+    }
+}
+
+/// Planes of one row, reused for every row a thread generates
+typedef struct RowNoise {
+    float* fuel;
+    float* moisture;
+    float* hills;
+    float* lattice;
+    uint8_t* types;
+} RowNoise;
+
+// Layers of each noise, the lattice scratch has to cover the finest of them
+#define FUEL_OCTAVES 4
+#define MOISTURE_OCTAVES 2
+#define HILL_OCTAVES 5
+
+static RowNoise createRowNoise(const GridGenOptions* options) {
+    const size_t width = options->width;
+    const float finest = (float)(1 << (FUEL_OCTAVES - 1)) / options->patch_size;
+    RowNoise noise = {
+        .fuel = malloc(width * sizeof(float)),
+        .moisture = malloc(width * sizeof(float)),
+        .hills = malloc(width * sizeof(float)),
+        .lattice = malloc(((size_t)((float)width * finest) + 3) * sizeof(float)),
+        .types = malloc(width),
+    };
+    if (!noise.fuel || !noise.moisture || !noise.hills || !noise.lattice || !noise.types) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return noise;
+}
+
+static void destroyRowNoise(RowNoise* noise) {
+    free(noise->fuel);
+    free(noise->moisture);
+    free(noise->hills);
+    free(noise->lattice);
+    free(noise->types);
+}
+
+/// Distance from the cell to the middle of the strip, in cells
+static float stripDistance(const Strip* strip, size_t row, size_t col) {
+    return strip->vertical ? fabsf((float)col - strip->centers[row]) : fabsf((float)row - strip->centers[col]);
+}
+
+static void generateRow(const GridGen* gen, size_t row, RowNoise* noise, PackedCell* cells, int* elevation) {
+    const GridGenOptions* options = gen->options;
+    const size_t width = options->width;
+    const float frequency = 1.0f / options->patch_size;
+    const float y = (float)row * frequency;
+
+    // The gradient from top to bottom, give or take 15 percent points
+    const float along = options->height > 1 ? (float)row / (float)(options->height - 1) : 0.0f;
+    const float gradient = (float)options->dry_moisture + (float)(options->wet_moisture - options->dry_moisture) * along;
+    for (size_t col = 0; col < width; col++) {
+        noise->fuel[col] = 0.0f;
+        noise->moisture[col] = gradient - 15.0f;
+    }
+    addNoiseRow(noise->fuel, width, options->seed, frequency, y, FUEL_OCTAVES, 1.0f, noise->lattice);
+    addNoiseRow(noise->moisture, width, options->seed + 101, frequency * 0.5f, y * 0.5f, MOISTURE_OCTAVES, 30.0f, noise->lattice);
+
+    if (elevation) {
+        for (size_t col = 0; col < width; col++)
+            noise->hills[col] = 0.0f;
+        addNoiseRow(noise->hills, width, options->seed + 202, frequency * 0.25f, y * 0.25f, HILL_OCTAVES, 800.0f, noise->lattice);
+    }
+
+    // The strips only change the cells near them
+    uint8_t* types = noise->types;
+    for (size_t col = 0; col < width; col++)
+        types[col] = (uint8_t)fuelAt(noise->fuel[col]);
+
+    for (size_t index = 0; index < gen->num_strips; index++) {
+        const Strip* strip = &gen->strips[index];
+        const float reach = strip->river ? 8.0f * strip->half_width : strip->half_width;
+        if ((float)row < strip->lowest - reach || (float)row > strip->highest + reach)
+            continue;
+
+        size_t first_col = 0;
+        size_t end_col = width;
+        if (strip->vertical) {
+            const float center = strip->centers[row];
+            first_col = center - reach > 0.0f ? (size_t)(center - reach) : 0;
+            end_col = center + reach + 1.0f < (float)width ? (size_t)(center + reach + 1.0f) : width;
+        }
+
+        for (size_t col = first_col; col < end_col; col++) {
+            const float distance = stripDistance(strip, row, col);
+            if (distance <= strip->half_width) {
+                types[col] = VEG_NOTFIREPRONE;
+                if (strip->river)
+                    noise->moisture[col] = 100.0f;
+            } else if (strip->river && distance < reach && noise->moisture[col] < 100.0f) {
+                // The banks are wetter the closer they are
+                noise->moisture[col] += 40.0f * (1.0f - distance / reach);
+            }
+        }
+    }
+
+    for (size_t col = 0; col < width; col++) {
+        if (elevation) {
+            const int meters = (int)noise->hills[col];
+            elevation[col] = meters > MAX_ELEVATION ? MAX_ELEVATION : meters;
+        }
+
+        const int percent = (int)lroundf(noise->moisture[col]);
+        cells[col] = (PackedCell) {
+            .state = CELLSTATE_NORMAL,
+            .type = types[col],
+            .moisture = (uint8_t)(percent < 0 ? 0 : percent > 100 ? 100 : percent),
+            .on_fire_counter = 0,
+        };
+    }
+}
+
+/// Writes `digits` digits of `value`, zero padded
+static char* writeDigits(char* out, unsigned int value, int digits) {
+    for (int digit = digits - 1; digit >= 0; digit--) {
+        out[digit] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return out + digits;
+}
+
+static char* writeCellText(char* out, PackedCell cell, const int* elevation) {
+    *out++ = (char)cell.state;
+    *out++ = ',';
+    *out++ = (char)cell.type;
+    *out++ = ',';
+    out = writeDigits(out, cell.moisture, 3);
+    *out++ = ',';
+    if (elevation) {
+        *out++ = *elevation < 0 ? '-' : '0';
+        out = writeDigits(out, (unsigned int)abs(*elevation), 5);
+        *out++ = ',';
+    }
+    *out++ = '\n';
+    return out;
+}
+
+static bool writeAt(int fd, const void* buffer, size_t bytes, size_t offset) {
+    const char* bytes_left = buffer;
+    while (bytes > 0) {
+        const ssize_t written = pwrite(fd, bytes_left, bytes, (off_t)offset);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes_left += written;
+        bytes -= (size_t)written;
+        offset += (size_t)written;
+    }
+    return true;
+}
+
+static void* gridGenWorkerMain(void* userdata) {
+    GridGen* gen = userdata;
+    const GridGenOptions* options = gen->options;
+    const size_t width = options->width;
+    const bool has_elevation = options->cell_size > 0;
+
+    PackedCell* cells = malloc(gen->rows_per_chunk * width * sizeof(PackedCell));
+    int* elevation = has_elevation ? malloc(gen->rows_per_chunk * width * sizeof(int)) : nullptr;
+    char* text = gen->text_fd >= 0 ? malloc(gen->rows_per_chunk * width * gen->text_cell_bytes) : nullptr;
+    if (!cells || (has_elevation && !elevation) || (gen->text_fd >= 0 && !text)) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    RowNoise noise = createRowNoise(options);
+
+    for (;;) {
+        pthread_mutex_lock(&gen->lock);
+        const size_t first_row = gen->next_row;
+        gen->next_row += gen->rows_per_chunk;
+        const bool stop = gen->failed;
+        pthread_mutex_unlock(&gen->lock);
+        if (stop || first_row >= options->height)
+            break;
+
+        const size_t end_row = first_row + gen->rows_per_chunk < options->height ? first_row + gen->rows_per_chunk : options->height;
+        const size_t num_cells = (end_row - first_row) * width;
+        for (size_t row = first_row; row < end_row; row++) {
+            const size_t offset = (row - first_row) * width;
+            generateRow(gen, row, &noise, cells + offset, elevation ? elevation + offset : nullptr);
+        }
+
+        for (size_t index = 0; index < gen->num_ignitions; index++) {
+            const GridGenIgnition ignition = gen->ignitions[index];
+            if (ignition.row >= first_row && ignition.row < end_row)
+                cells[(ignition.row - first_row) * width + ignition.col].state = CELLSTATE_ONFIRE;
+        }
+
+        bool ok = true;
+        if (gen->bin_fd >= 0) {
+            const size_t offset = sizeof(CellbinHeader) + first_row * width * sizeof(PackedCell);
+            ok = writeAt(gen->bin_fd, cells, num_cells * sizeof(PackedCell), offset);
+        }
+        if (ok && text) {
+            char* out = text;
+            for (size_t index = 0; index < num_cells; index++)
+                out = writeCellText(out, cells[index], elevation ? &elevation[index] : nullptr);
+
+            const size_t offset = gen->text_header_bytes + first_row * width * gen->text_cell_bytes;
+            ok = writeAt(gen->text_fd, text, (size_t)(out - text), offset);
+        }
+
+        if (!ok) {
+            fprintf(stderr, "ERROR: failed to write rows %zu to %zu: %s\n", first_row, end_row, strerror(errno));
+            pthread_mutex_lock(&gen->lock);
+            gen->failed = true;
+            pthread_mutex_unlock(&gen->lock);
+            break;
+        }
+    }
+
+    destroyRowNoise(&noise);
+    free(cells);
+    free(elevation);
+    free(text);
+    return nullptr;
+}
+
+/// Rivers wander along a noise curve, firebreaks are straight
+static void placeStrips(GridGen* gen, Rng* rng) {
+    const GridGenOptions* options = gen->options;
+    gen->num_strips = options->num_rivers + options->num_firebreaks;
+    gen->strips = calloc(gen->num_strips ? gen->num_strips : 1, sizeof(Strip));
+    if (!gen->strips) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t index = 0; index < gen->num_strips; index++) {
+        Strip* strip = &gen->strips[index];
+        strip->river = index < options->num_rivers;
+        strip->vertical = rngNext(rng) & 1;
+        strip->half_width = strip->river ? 1.5f : 1.0f;
+
+        const size_t length = strip->vertical ? options->height : options->width;
+        const size_t across = strip->vertical ? options->width : options->height;
+        strip->centers = malloc((length ? length : 1) * sizeof(float));
+        if (!strip->centers) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        const float start = rngFloat(rng) * (float)across;
+        const float swing = strip->river ? 0.15f * (float)across : 0.0f;
+        const uint64_t curve_seed = rngNext(rng);
+        strip->lowest = start + swing;
+        strip->highest = start - swing;
+        for (size_t along = 0; along < length; along++) {
+            const float wander = fractalNoise(curve_seed, (float)along / (4.0f * options->patch_size), 0.5f, 3) - 0.5f;
+            strip->centers[along] = start + 2.0f * swing * wander;
+            strip->lowest = fminf(strip->lowest, strip->centers[along]);
+            strip->highest = fmaxf(strip->highest, strip->centers[along]);
+        }
+        // A vertical strip crosses every row
+        if (strip->vertical) {
+            strip->lowest = 0.0f;
+            strip->highest = (float)options->height;
+        }
+    }
+}
+
+static bool placeIgnitions(GridGen* gen, Rng* rng) {
+    const GridGenOptions* options = gen->options;
+    gen->num_ignitions = options->num_ignitions + options->random_ignitions;
+    gen->ignitions = malloc((gen->num_ignitions ? gen->num_ignitions : 1) * sizeof(GridGenIgnition));
+    if (!gen->ignitions) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t index = 0; index < options->num_ignitions; index++) {
+        const GridGenIgnition ignition = options->ignitions[index];
+        if (ignition.row >= options->height || ignition.col >= options->width) {
+            fprintf(stderr, "ERROR: ignition %zu,%zu is outside the %zux%zu grid\n", ignition.row, ignition.col,
+                    options->width, options->height);
+            return false;
+        }
+        gen->ignitions[index] = ignition;
+    }
+
+    for (size_t index = options->num_ignitions; index < gen->num_ignitions; index++) {
+        gen->ignitions[index] = (GridGenIgnition) {
+            .row = (size_t)(rngNext(rng) % options->height),
+            .col = (size_t)(rngNext(rng) % options->width),
+        };
+    }
+    return true;
+}
+
+static int createOutput(const char* path) {
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        fprintf(stderr, "Failed to open file: %s\n", path);
+    return fd;
+}
+
+bool generateGrid(const GridGenOptions* options, const char* cellgrid_path, const char* cellbin_path) {
+    if (options->width == 0 || options->height == 0 || options->width > INT32_MAX || options->height > INT32_MAX) {
+        fputs("ERROR: the width and height have to be between 1 and 2147483647\n", stderr);
+        return false;
+    }
+    if (options->windX < -1 || options->windX > 1 || options->windY < -1 || options->windY > 1 || options->speed >= WIND_LAST) {
+        fputs("ERROR: invalid wind\n", stderr);
+        return false;
+    }
+    if (options->patch_size < 1.0f) {
+        fputs("ERROR: the patch size has to be at least 1 cell\n", stderr);
+        return false;
+    }
+
+    size_t num_threads = options->num_threads;
+    if (num_threads == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t)online : 1;
+    }
+
+    GridGen gen = {
+        .options = options,
+        .text_fd = -1,
+        .bin_fd = -1,
+        .text_cell_bytes = options->cell_size > 0 ? CELL_TEXT_ELEVATION_BYTES : CELL_TEXT_BYTES,
+        .rows_per_chunk = GRIDGEN_CHUNK_CELLS / options->width ? GRIDGEN_CHUNK_CELLS / options->width : 1,
+    };
+
+    Rng rng = seedRng(options->seed);
+    placeStrips(&gen, &rng);
+    bool ok = placeIgnitions(&gen, &rng);
+
+    if (ok && cellgrid_path) {
+        gen.text_fd = createOutput(cellgrid_path);
+        ok = gen.text_fd >= 0;
+
+        char header[128];
+        if (options->cell_size > 0) {
+            snprintf(header, sizeof(header), "%zu,%zu,%d,%d,%d,%d,\n", options->width, options->height,
+                     options->windX, options->windY, (int)options->speed, options->cell_size);
+        } else {
+            snprintf(header, sizeof(header), "%zu,%zu,%d,%d,%d,\n", options->width, options->height,
+                     options->windX, options->windY, (int)options->speed);
+        }
+        gen.text_header_bytes = strlen(header);
+        ok = ok && writeAt(gen.text_fd, header, gen.text_header_bytes, 0);
+    }
+    if (ok && cellbin_path) {
+        gen.bin_fd = createOutput(cellbin_path);
+        ok = gen.bin_fd >= 0;
+
+        const CellbinHeader header = makeCellbinHeader(options->width, options->height, options->windX, options->windY, options->speed);
+        ok = ok && writeAt(gen.bin_fd, &header, sizeof(header), 0);
+    }
+
+    if (ok) {
+        pthread_mutex_init(&gen.lock, nullptr);
+        pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+        if (!threads) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        size_t started = 0;
+        for (; started < num_threads; started++) {
+            if (pthread_create(&threads[started], nullptr, gridGenWorkerMain, &gen) != 0)
+                break;
+        }
+        // The threads that did start take the rows of the others
+        if (started == 0)
+            gridGenWorkerMain(&gen);
+        for (size_t index = 0; index < started; index++)
+            pthread_join(threads[index], nullptr);
+
+        free(threads);
+        pthread_mutex_destroy(&gen.lock);
+        ok = !gen.failed;
+    }
+
+    if (gen.text_fd >= 0)
+        ok = close(gen.text_fd) == 0 && ok;
+    if (gen.bin_fd >= 0)
+        ok = close(gen.bin_fd) == 0 && ok;
+
+    for (size_t index = 0; index < gen.num_strips; index++)
+        free(gen.strips[index].centers);
+    free(gen.strips);
+    free(gen.ignitions);
+    return ok;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "cell.h"
+#include <stdint.h>
+
+/*
+ * Procedural grids for benchmarks and stress tests, far bigger than the Python editor can make.
+ *
+ * Every cell is a pure function of its position and the seed: fuel patches and moisture come from
+ * value noise, the moisture also follows a gradient from the top row to the bottom row, and rivers
+ * and firebreaks are strips of VEG_NOTFIREPRONE, the rivers soaked. So the rows can be generated
+ * by any number of threads in any order and the grid is the same for the same options.
+ */
+
+typedef struct GridGenIgnition {
+    size_t row;
+    size_t col;
+} GridGenIgnition;
+
+typedef struct GridGenOptions {
+    size_t width;
+    size_t height;
+    uint64_t seed;
+    int windX;
+    int windY;
+    WindSpeed speed;
+    float patch_size;     // cells across a typical patch of one fuel
+    int dry_moisture;     // percent around the top row
+    int wet_moisture;     // percent around the bottom row
+    size_t num_rivers;    // meandering, soaked, 3 cells wide
+    size_t num_firebreaks; // straight, 2 cells wide
+    const GridGenIgnition* ignitions;
+    size_t num_ignitions;
+    size_t random_ignitions; // placed from the seed on top of `ignitions`
+    int cell_size;        // meters, 0 for a grid without elevation
+    size_t num_threads;   // 0 for one per CPU
+} GridGenOptions;
+
+/// Generates the grid into a text .cellgrid and a .cellbin, either path can be null to skip it.
+/// The .cellbin has no elevation, like every .cellbin.
+/// The text cells are written with a fixed width ("N,G,065," with zero padded numbers, which
+/// `readInitialState` reads like any other), so every thread writes its rows straight to their place.
+bool generateGrid(const GridGenOptions* options, const char* cellgrid_path, const char* cellbin_path);
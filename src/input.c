@@ -1,5 +1,7 @@
 #include "input.h"
 #include "cell.h"
+#include "terrain.h"
+#include "wind_field.h"
 #include "string.h"
 #include <stdint.h>
 #include <stdio.h>
@@ -45,12 +47,12 @@ static size_t parseNumberValues(const char* buf, int* const * addresses, size_t
     return idx;
 }
 
-CellularAutomaton readInitialState(const char* path) {
+bool openCellgrid(const char* path, CellgridReader* reader) {
     FILE* fd = fopen(path, "r");
     if (!fd) {
         fprintf(stderr, "Failed to open file: %s\n", path);
-        goto err_dont_close;
-    } 
+        return false;
+    }
 
     // Headers
     int width;
@@ -77,6 +79,21 @@ CellularAutomaton readInitialState(const char* path) {
         fputs("Failed reading header values\n", stderr);
         goto err_close_file;
     }
+
+    // An optional 6th header value is the cell size in meters, then every cell also has an elevation
+    int cell_size = 0;
+    const bool has_elevation = header_line[bytes_read] != '\n' && header_line[bytes_read] != '\r' && header_line[bytes_read] != '\0';
+    if (has_elevation) {
+        int* const cell_size_address[] = {&cell_size};
+        if (parseNumberValues(header_line + bytes_read, cell_size_address, 1) == 0) {
+            fputs("Failed reading header value \"cell size\"\n", stderr);
+            goto err_close_file;
+        }
+        if (cell_size <= 0) {
+            fputs("ERROR: Header value \"cell size\" has to be positive\n", stderr);
+            goto err_close_file;
+        }
+    }
     
     if (height < 0) {
         fputs("ERROR: Header value \"height\" has a negative value\n", stderr);
@@ -99,13 +116,161 @@ CellularAutomaton readInitialState(const char* path) {
         goto err_close_file;
     }
 
+    *reader = (CellgridReader) {
+        .fd = fd,
+        .path = path,
+        .width = (size_t)width,
+        .height = (size_t)height,
+        .windX = windX,
+        .windY = windY,
+        .speed = (WindSpeed)speed,
+        .has_elevation = has_elevation,
+        .cell_size = (float)cell_size,
+        .cell_num = 0,
+    };
+    return true;
+
+err_failed_read:
+    fprintf(stderr, "ERROR: failed to read file \"%s\"\n", path);
+
+err_close_file:
+    fclose(fd);
+    return false;
+}
+
+bool readNextCell(CellgridReader* reader, Cell* cell, float* elevation) {
+    const size_t cell_num = reader->cell_num;
+    if (cell_num >= reader->width * reader->height) {
+        fprintf(stderr, "Cell number exceeded number allocated: %zu\n", cell_num); 
+        return false;
+    }
+
+    char line[128];
+    if (!fgets(line, sizeof(line), reader->fd)) {
+        fprintf(stderr, "Not enough cells.\nGot %zu cells\nGridsize: %zu * %zu = %zu\n",
+                cell_num, reader->width, reader->height, reader->width * reader->height);
+        return false;
+    }
+
+    uint8_t idx = 0;
+    const uint8_t line_len = (uint8_t)strlen(line);
+    // Line too long
+    if (line_len == sizeof(line)) {
+        fputs("Line too long", stderr);
+        return false;
+    }
+
+    // Line too short
+    if (line_len < strlen("N,T,0,\n")) {
+        fputs("Line too short", stderr);
+        return false;
+    }
+
+    // parse state
+    CellState state;
+    switch (line[idx]) {
+    case 'N':
+    case 'F':
+    case 'O':
+        state = (CellState)line[idx];
+        break;
+
+    default:
+        fprintf(stderr, "Invalid cell state \"%c\" at cell number: %zu\n", line[idx], cell_num);
+        return false;
+    }
+    idx++;
+    if (line[idx] != ',') {
+        fprintf(stderr, "Missing comma at cell number: %zu\n", cell_num);
+        return false;
+    }
+    idx++;
+
+    // parse type
+    VegType type;
+    switch (line[idx]) {
+    case 'B':
+    case 'S':
+    case 'G':
+    case 'F':
+    case 'A':
+    case 'N':
+        type = (VegType)line[idx];
+        break;
+    default: 
+        fprintf(stderr, "Invalid cell type \"%c\" at cell number: %zu\n", line[idx], cell_num);
+        return false;
+    }
+    idx++;
+    if (line[idx] != ',') {
+        fprintf(stderr, "Missing comma at cell number: %zu\n", cell_num);
+        return false;
+    }
+    idx++;
+
+    // parse number values
+    int moisture;
+    int height_above_sea = 0;
+    int* const vals[] = {&moisture, &height_above_sea};
+
+    const size_t bytes_read = parseNumberValues(line + idx, vals, reader->has_elevation ? 2 : 1);
+    if (bytes_read == 0) {
+        fprintf(stderr, "Error reading number values at cell number: %zu\n", cell_num );
+        return false;
+    }
+
+    // Done parsing the cell!!!
+    if (moisture < 0) {
+        fprintf(stderr, "Moisture at cell %zu, was set to a negative value!\n", cell_num);
+        return false;
+    }
+    if (moisture > 100) {
+        fprintf(stderr, "Moisture at cell %zu, was set to over 100!\n", cell_num);
+        return false;
+    }
+
+    // convert numbers to floats
+    const float m = (float)moisture / 100.f;
+
+    *cell = (Cell){
+        .state = state,
+        .type = type,
+        .on_fire_counter = 0,
+        .moisture = m,
+    };
+    *elevation = (float)height_above_sea;
+
+    reader->cell_num++;
+    return true;
+}
+
+bool closeCellgrid(CellgridReader* reader) {
+    // Nothing may follow the last cell
+    char line[128];
+    const bool extra_line = fgets(line, sizeof(line), reader->fd) != nullptr;
+    const bool at_end = !extra_line && feof(reader->fd);
+    if (extra_line)
+        fprintf(stderr, "Cell number exceeded number allocated: %zu\n", reader->cell_num);
+    else if (!at_end)
+        fprintf(stderr, "ERROR: failed to read file \"%s\"\n", reader->path);
+
+    fclose(reader->fd);
+    reader->fd = nullptr;
+    return at_end;
+}
+
+CellularAutomaton readInitialState(const char* path) {
+    CellgridReader reader;
+    if (!openCellgrid(path, &reader))
+        goto err_dont_close;
+
     // Correctly typed versions
-    const size_t h = (size_t)height;
-    const size_t w = (size_t)width;
+    const size_t h = reader.height;
+    const size_t w = reader.width;
     CellArray* cell_arrays = malloc(sizeof(CellArray) * h);
     if (!cell_arrays) {
         fprintf(stderr, "Out Of Memory\n");
-        fclose(fd);
+        fclose(reader.fd);
         exit(EXIT_FAILURE);
     }
 
@@ -113,10 +278,20 @@ CellularAutomaton readInitialState(const char* path) {
     Cell* cells = malloc(sizeof(Cell) * h * w);
     if (!cells) {
         fprintf(stderr, "Out Of Memory\n");
-        fclose(fd);
+        fclose(reader.fd);
         exit(EXIT_FAILURE);
     }
 
+    float* elevation = nullptr;
+    if (reader.has_elevation) {
+        elevation = malloc(sizeof(float) * h * w);
+        if (!elevation) {
+            fprintf(stderr, "Out Of Memory\n");
+            fclose(reader.fd);
+            exit(EXIT_FAILURE);
+        }
+    }
+
     // Distribute cell memory among the CellArrays
     for (size_t i = 0; i < h; i++) {
         cell_arrays[i] = (CellArray){
@@ -125,135 +300,170 @@ CellularAutomaton readInitialState(const char* path) {
         };
     }
 
-    const CellularAutomaton automaton = {
+    CellularAutomaton automaton = {
         .num_rows = h,
         .rows = cell_arrays,
-        .windY = windY,
-        .windX = windX,
-        .speed = (WindSpeed)speed,
+        .windY = reader.windY,
+        .windX = reader.windX,
+        .speed = reader.speed,
+        .step = 0,
+        .burnout = nullptr,
+        .terrain = nullptr,
+        .wind = nullptr,
+        .arena = nullptr,
     };
 
     // Parse the cells
-    char line[128];
-    size_t cell_num = 0;
-    for (; fgets(line, sizeof(line), fd); cell_num++) {
-        if (cell_num >= w * h) {
-            fprintf(stderr, "Cell number exceeded number allocated: %zu\n", cell_num); 
+    for (size_t cell_num = 0; cell_num < w * h; cell_num++) {
+        float height_above_sea;
+        if (!readNextCell(&reader, &cells[cell_num], &height_above_sea))
             goto err_close_file;
-        }
 
-        uint8_t idx = 0;
-        const uint8_t line_len = (uint8_t)strlen(line);
-        // Line too long
-        if (line_len == sizeof(line)) {
-            fputs("Line too long", stderr);
-            goto err_close_file;
-        }
+        if (elevation)
+            elevation[cell_num] = height_above_sea;
+    }
 
-        // Line too short
-        if (line_len < strlen("N,T,0,\n")) {
-            fputs("Line too short", stderr);
-            goto err_close_file;
-        }
+    if (!closeCellgrid(&reader))
+        goto err_free_cells;
 
-        // parse state
-        CellState state;
-        switch (line[idx]) {
-        case 'N':
-        case 'F':
-        case 'O':
-            state = (CellState)line[idx];
-            break;
-
-        default:
-            fprintf(stderr, "Invalid cell state \"%c\" at cell number: %zu\n", line[idx], cell_num);
-            goto err_close_file;
-        }
-        idx++;
-        if (line[idx] != ',') {
-            fprintf(stderr, "Missing comma at cell number: %zu\n", cell_num);
-            goto err_close_file;
-        }
-        idx++;
+    // Precompute the slopes now that the whole elevation plane is known
+    if (elevation)
+        automaton.terrain = createTerrain(elevation, h, w, reader.cell_size);
 
-        // parse type
-        VegType type;
-        switch (line[idx]) {
-        case 'B':
-        case 'S':
-        case 'G':
-        case 'F':
-        case 'A':
-        case 'N':
-            type = (VegType)line[idx];
-            break;
-        default: 
-            fprintf(stderr, "Invalid cell type \"%c\" at cell number: %zu\n", line[idx], cell_num);
-            goto err_close_file;
-        }
-        idx++;
-        if (line[idx] != ',') {
-            fprintf(stderr, "Missing comma at cell number: %zu\n", cell_num);
-            goto err_close_file;
-        }
-        idx++;
+    return automaton;
 
-        // parse number values
-        int moisture;
-        int* const vals[] = {&moisture};
+// ez pz error handling in c
+// super useful
+err_close_file:
+    fclose(reader.fd); // Now we will never forget to close the file
 
-        const size_t bytes_read = parseNumberValues(line + idx, vals, 1);
-        if (bytes_read == 0) {
-            fprintf(stderr, "Error reading number values at cell number: %zu\n", cell_num );
-            goto err_close_file;
+err_free_cells:
+    free(elevation);
+    free(cells);
+    free(cell_arrays);
+
+err_dont_close:
+    return (CellularAutomaton){
+        .num_rows = 0,
+        .rows = nullptr,
+        .windX = 0.f,
+        .windY = 0.f,
+        .burnout = nullptr,
+        .terrain = nullptr,
+        .wind = nullptr,
+        .arena = nullptr,
+    };
+}
+
+WindField* readWindField(const char* path, size_t num_rows, size_t num_columns) {
+    FILE* fd = fopen(path, "r");
+    if (!fd) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return nullptr;
+    }
+
+    // Headers
+    int block_size;
+    int num_frames;
+    int* header_addresses[] = {&block_size, &num_frames};
+
+    char line[128];
+    if (!fgets(line, sizeof(line), fd))
+        goto err_failed_read;
+
+    if (parseNumberValues(line, header_addresses, 2) == 0) {
+        fputs("Failed reading wind field header values\n", stderr);
+        goto err_close_file;
+    }
+    if (block_size <= 0) {
+        fputs("ERROR: Header value \"block size\" has to be positive\n", stderr);
+        goto err_close_file;
+    }
+    if (num_frames <= 0) {
+        fputs("ERROR: Header value \"frames\" has to be positive\n", stderr);
+        goto err_close_file;
+    }
+
+    // The last block in each direction may stick out of the grid
+    const size_t size = (size_t)block_size;
+    const size_t blocks_x = (num_columns + size - 1) / size;
+    const size_t blocks_y = (num_rows + size - 1) / size;
+    const size_t num_blocks = blocks_x * blocks_y;
+
+    WindFrame* frames = malloc(sizeof(WindFrame) * (size_t)num_frames);
+    BlockWind* blocks = malloc(sizeof(BlockWind) * num_blocks * (size_t)num_frames);
+    if (!frames || !blocks) {
+        fprintf(stderr, "Out Of Memory\n");
+        fclose(fd);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t frame = 0; frame < (size_t)num_frames; frame++) {
+        int start_step;
+        int* const start_address[] = {&start_step};
+        if (!fgets(line, sizeof(line), fd) || parseNumberValues(line, start_address, 1) == 0) {
+            fprintf(stderr, "Failed reading the start step of wind frame %zu\n", frame);
+            goto err_free;
         }
 
-        // Done parsing the cell!!!
-        if (moisture < 0) {
-            fprintf(stderr, "Moisture at cell %zu, was set to a negative value!\n", cell_num);
-            goto err_close_file;
+        // The frames have to follow each other, starting with the first step
+        if (start_step < 0) {
+            fprintf(stderr, "ERROR: Wind frame %zu starts at a negative step\n", frame);
+            goto err_free;
         }
-        if (moisture > 100) {
-            fprintf(stderr, "Moisture at cell %zu, was set to over 100!\n", cell_num);
-            goto err_close_file;
+        if (frame == 0 && start_step != 0) {
+            fputs("ERROR: The first wind frame has to start at step 0\n", stderr);
+            goto err_free;
+        }
+        if (frame > 0 && (size_t)start_step <= frames[frame - 1].start_step) {
+            fprintf(stderr, "ERROR: Wind frame %zu doesn't start after the previous one\n", frame);
+            goto err_free;
         }
 
-        // convert numbers to floats
-        const float m = (float)moisture / 100.f;
-
-        cells[cell_num] = (Cell){
-            .state = state,
-            .type = type,
-            .on_fire_counter = 0,
-            .moisture = m,
+        frames[frame] = (WindFrame) {
+            .start_step = (size_t)start_step,
+            .blocks = blocks + frame * num_blocks,
         };
-    }
 
-    if (cell_num < w * h) {
-        fprintf(stderr, "Not enough cells.\nGot %zu cells\nGridsize: %zu * %zu = %zu\n", cell_num, w, h, w * h);
-        goto err_close_file;
+        for (size_t block = 0; block < num_blocks; block++) {
+            int windX;
+            int windY;
+            int speed;
+            int* const vals[] = {&windX, &windY, &speed};
+            if (!fgets(line, sizeof(line), fd) || parseNumberValues(line, vals, 3) == 0) {
+                fprintf(stderr, "Failed reading block %zu of wind frame %zu\n", block, frame);
+                goto err_free;
+            }
+
+            if (windX > 1 || windX < -1 || windY > 1 || windY < -1) {
+                fprintf(stderr, "ERROR: Wind direction of block %zu in frame %zu is not between 1 and -1\n", block, frame);
+                goto err_free;
+            }
+            if (speed < 0 || speed > 4) {
+                fprintf(stderr, "ERROR: Wind speed of block %zu in frame %zu is not between 0 and 4\n", block, frame);
+                goto err_free;
+            }
+
+            frames[frame].blocks[block] = (BlockWind) {
+                .windX = windX,
+                .windY = windY,
+                .speed = (WindSpeed)speed,
+            };
+        }
     }
 
-    if (!feof(fd))
-        goto err_failed_read;
-
     fclose(fd);
+    return createWindField(frames, (size_t)num_frames, size, blocks_x, blocks_y);
 
-    return automaton;
+err_free:
+    free(blocks);
+    free(frames);
+    goto err_close_file;
 
-// ez pz error handling in c
-// super useful
 err_failed_read:
     fprintf(stderr, "ERROR: failed to read file \"%s\"\n", path);
 
 err_close_file:
-    fclose(fd); // Now we will never forget to close the file
-
-err_dont_close:
-    return (CellularAutomaton){
-        .num_rows = 0,
-        .rows = nullptr,
-        .windX = 0.f,
-        .windY = 0.f,
-    };
+    fclose(fd);
+    return nullptr;
 }
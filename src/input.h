@@ -1,5 +1,32 @@
 #pragma once
 
 #include "cell.h"
+#include <stdio.h>
 
 CellularAutomaton readInitialState(const char* path);
+
+/// Reads a .cellgrid one cell at a time, for grids too big to load at once
+typedef struct CellgridReader {
+    FILE* fd;
+    const char* path;
+    size_t width;
+    size_t height;
+    int windX;
+    int windY;
+    WindSpeed speed;
+    bool has_elevation;
+    float cell_size;
+    size_t cell_num; // cells read so far
+} CellgridReader;
+
+/// Opens the file and parses the header
+bool openCellgrid(const char* path, CellgridReader* reader);
+/// Parses the next cell, row by row. The elevation is 0 when the grid has none.
+bool readNextCell(CellgridReader* reader, Cell* cell, float* elevation);
+/// Closes the file, returns false if anything follows the last cell
+bool closeCellgrid(CellgridReader* reader);
+
+/// Reads a wind field for a grid of the given size.
+/// The file starts with "block_size,num_frames," followed by every frame, which is a line with
+/// its start step and then a "windX,windY,speed," line per block, row by row.
+WindField* readWindField(const char* path, size_t num_rows, size_t num_columns);
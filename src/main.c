@@ -10,10 +10,14 @@
 #include "SDL3/SDL_video.h"
 #include "cell.h"
 #include "display.h"
+#include "pyramid.h"
 #include "input.h"
-#include "direct_spread.h"
-#include "spotting_spread.h"
 #include "burnout_cell.h"
+#include "simulation.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include "arena.h"
+#include "random.h"
 #include "wchar.h"
 
 #include <SDL3/SDL.h>
@@ -25,10 +29,11 @@ time_t time_diff(struct timeval *start, struct timeval *end) {
 
 int main(int argc, char const* const* argv) {
     // Random seed for the random function
-    srand((unsigned int)time(nullptr));
+    seedSimulation((uint64_t)time(nullptr));
 
-    if (argc != 2) {
-        fputs("ERROR: Too many or too little arguments", stderr);
+    if (argc != 2 && argc != 3) {
+        fputs("ERROR: Too many or too little arguments\n"
+              "Usage: wildfire-spotting <grid.cellgrid> [wind.windfield]\n", stderr);
         exit(EXIT_FAILURE);
     }
 
@@ -39,10 +44,39 @@ int main(int argc, char const* const* argv) {
         return EXIT_FAILURE;
     }
 
+    // Optional wind varying over the grid and over time, instead of the wind in the grid header
+    if (argc == 3) {
+        automaton.wind = readWindField(argv[2], automaton.num_rows, automaton.rows[0].count);
+        if (!automaton.wind) {
+            fputs("We failed reading the wind field :(\n", stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Everything the steps need is reserved up front, so stepping never allocates:
+    // two grids, the burnout wheel, the slope factors and the wind field
+    const size_t num_rows = automaton.num_rows;
+    const size_t num_columns = automaton.rows[0].count;
+    SimArena* arena = createArena(arenaGridBytes(num_rows, num_columns, 2) + num_rows * num_columns * sizeof(size_t) + ARENA_ALIGNMENT
+                                      + terrainArenaBytes(automaton.terrain) + windFieldArenaBytes(automaton.wind),
+                                  ARENA_HUGE_PAGES | ARENA_TRANSPARENT_HUGE_PAGES | ARENA_PREFAULT);
+    if (!arena)
+        return EXIT_FAILURE;
+    arenaReserveGrids(arena, num_rows, num_columns, 2);
+    automaton = moveIntoArena(&automaton, arena);
+
+    // Burnouts are scheduled when cells ignite instead of counted every step
+    BurnoutWheel burnout = createBurnoutWheel(&automaton);
+    automaton.burnout = &burnout;
+
     SDLState state = initSDL(16 * 80, 9 * 80);
     if (state.win == nullptr) {
         return 1;
     }
+    fitView(&state, num_rows, num_columns);
+
+    // What gets drawn, kept up to date from the burnout wheel instead of reading every cell
+    GridPyramid pyramid = createGridPyramid(&automaton);
 
     int step;
 
@@ -61,11 +95,17 @@ int main(int argc, char const* const* argv) {
         SDL_Event event;
         SDL_zero(event);
 
+        bool view_changed = false;
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_EVENT_QUIT)
                 running = false;
+            view_changed |= handleViewEvent(&state, &event, num_rows, num_columns);
         }
 
+        // Zooming and panning draw right away, also once the simulation is done
+        if (view_changed)
+            display(&state, &pyramid);
+
         if (i >= step)
             continue;
 
@@ -77,31 +117,31 @@ int main(int argc, char const* const* argv) {
 
         gettimeofday(&begin, NULL);
 
-        display(&state, &automaton);
-
-        // Spread fire
-        CellularAutomaton new = directSpread(&automaton);
-        destroyAutomaton(&automaton);
-        automaton = new;
+        updateGridPyramid(&pyramid, &automaton);
+        display(&state, &pyramid);
 
-        // Spread fire via spotting
-        new = spottingSpread(&automaton);
-        destroyAutomaton(&automaton);
-        automaton = new;
+        // Jump over the steps where the fire can't do anything but wait to burn out
+        const size_t skipped = skipIdleSteps(&automaton, (size_t)(step - i));
+        skipGridPyramidSteps(&pyramid, skipped);
+        i += (int)skipped;
+        if (i >= step)
+            continue;
 
-        // Burn cells based on heal / fuel left
-        new = burnoutCells(&automaton);
-        destroyAutomaton(&automaton);
-        automaton = new;
+        stepAutomaton(&automaton);
 
         i++;
     }
 
+    destroyGridPyramid(&pyramid);
     destroyAutomaton(&automaton);
+    destroyBurnoutWheel(&burnout);
+    destroyTerrain(automaton.terrain);
+    destroyWindField(automaton.wind);
+
+    printArenaStats(arena, stderr);
+    destroyArena(arena);
 
-    SDL_DestroySurface(state.surf);
-    SDL_DestroyWindow(state.win);
-    SDL_Quit();
+    destroySDL(&state);
     return 0;
 
 }
@@ -0,0 +1,461 @@
+#define _GNU_SOURCE // MADV_HUGEPAGE
+#include "parallel_step.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "direct_spread.h"
+#include "random.h"
+#include "spotting_spread.h"
+#include "terrain.h"
+#include "topology.h"
+#include "wind_field.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/// A firebrand landing, applied by the worker owning the row once everyone has thrown theirs
+typedef struct Ignition {
+    size_t row;
+    size_t col;
+} Ignition;
+
+typedef struct Worker {
+    ParallelStepper* stepper;
+    pthread_t thread;
+    size_t index;
+    size_t first_row;
+    size_t end_row;
+    long cpu; // -1 when not pinned
+    Rng rng;
+
+    Ignition* outbox;
+    size_t outbox_count;
+    size_t outbox_capacity;
+} Worker;
+
+/// Workers wait on this before touching any barrier, which are sized for all of them
+typedef enum LaunchState {
+    LAUNCH_PENDING,
+    LAUNCH_GO,
+    LAUNCH_ABORT, // a worker couldn't be started, the others just return
+} LaunchState;
+
+struct ParallelStepper {
+    // Two planes, one is read while the other is written, then they swap
+    Cell* planes[2];
+    CellArray* rows[2];
+    size_t current;
+    size_t num_rows;
+    size_t num_columns;
+    size_t plane_bytes;
+
+    // Wind, terrain, wind field and step of the simulated automaton
+    CellularAutomaton config;
+    const Cell* source; // only used while the workers touch their bands for the first time
+    bool numa_aware;
+
+    Worker* workers;
+    size_t num_workers;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    pthread_barrier_t phase;
+    size_t steps_to_run;
+    bool quit;
+
+    pthread_mutex_t launch_lock;
+    pthread_cond_t launched;
+    LaunchState launch;
+};
+
+static Cell* allocatePlane(size_t bytes) {
+    // Not touched here, the pages land on the node of whoever writes them first
+    void* plane = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (plane == MAP_FAILED) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    madvise(plane, bytes, MADV_HUGEPAGE);
+    return plane;
+}
+
+static CellArray* rowTable(Cell* plane, size_t num_rows, size_t num_columns) {
+    CellArray* rows = malloc(num_rows * sizeof(CellArray));
+    if (!rows) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t row = 0; row < num_rows; row++) {
+        rows[row] = (CellArray) {
+            .count = num_columns,
+            .elements = plane + row * num_columns,
+        };
+    }
+    return rows;
+}
+
+// Both planes of the band start out as the initial state
+static void touchBand(const Worker* worker) {
+    const ParallelStepper* stepper = worker->stepper;
+    const size_t offset = worker->first_row * stepper->num_columns;
+    const size_t bytes = (worker->end_row - worker->first_row) * stepper->num_columns * sizeof(Cell);
+
+    memcpy(stepper->planes[0] + offset, stepper->source + offset, bytes);
+    memcpy(stepper->planes[1] + offset, stepper->source + offset, bytes);
+}
+
+static CellularAutomaton planeView(const ParallelStepper* stepper, size_t plane) {
+    CellularAutomaton view = stepper->config;
+    view.rows = stepper->rows[plane];
+    view.num_rows = stepper->num_rows;
+    view.burnout = nullptr;
+    view.arena = nullptr;
+    return view;
+}
+
+/// Direct spread, pulled from the point of view of the cell that might catch fire,
+/// so every worker only ever writes its own band.
+/// Each burning neighbour gets its own try, like when they push in `directSpread`.
+static void pullDirectSpread(Worker* worker, const CellularAutomaton* in, CellularAutomaton* out, const float uniform_weights[8]) {
+    for (size_t row = worker->first_row; row < worker->end_row; row++) {
+        const Cell* in_row = in->rows[row].elements;
+        Cell* out_row = out->rows[row].elements;
+
+        for (size_t col = 0; col < in->rows[row].count; col++) {
+            const Cell* dst = &in_row[col];
+            out_row[col] = *dst;
+            if (dst->state != CELLSTATE_NORMAL)
+                continue;
+
+            for (int dy = -1; dy <= 1 && out_row[col].state == CELLSTATE_NORMAL; dy++) {
+                const ptrdiff_t src_row = (ptrdiff_t)row + dy;
+                if (src_row < 0 || src_row >= (ptrdiff_t)in->num_rows)
+                    continue;
+
+                for (int dx = -1; dx <= 1; dx++) {
+                    const ptrdiff_t src_col = (ptrdiff_t)col + dx;
+                    if ((dx == 0 && dy == 0) || src_col < 0 || src_col >= (ptrdiff_t)in->rows[row].count)
+                        continue;
+
+                    const Cell* src = &in->rows[src_row].elements[src_col];
+                    if (src->state != CELLSTATE_ONFIRE)
+                        continue;
+
+                    // Offset from the burning cell to this one
+                    const size_t direction = neighbourIndex(-dx, -dy);
+                    const float a_w = in->wind
+                        ? blockSpreadWeights(in->wind, (size_t)src_row, (size_t)src_col)[direction]
+                        : uniform_weights[direction];
+                    const float a_h = in->terrain
+                        ? slopeFactor(in->terrain, (size_t)src_row, (size_t)src_col, -dx, -dy)
+                        : 1.0f;
+
+                    if (rngFloat(&worker->rng) >= chanceToSpread(src, dst, a_w, a_h))
+                        continue;
+
+                    out_row[col].state = CELLSTATE_ONFIRE;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static void sendIgnition(Worker* worker, size_t row, size_t col) {
+    if (worker->outbox_count == worker->outbox_capacity) {
+        const size_t capacity = worker->outbox_capacity ? worker->outbox_capacity * 2 : 1024;
+        Ignition* outbox = realloc(worker->outbox, capacity * sizeof(Ignition));
+        if (!outbox) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        worker->outbox = outbox;
+        worker->outbox_capacity = capacity;
+    }
+
+    worker->outbox[worker->outbox_count++] = (Ignition) {
+        .row = row,
+        .col = col,
+    };
+}
+
+/// Spotting from the burning cells of the band, same rules as `spottingSpread`.
+/// Firebrands can land in other bands, so all landings go through the outbox.
+static void throwFirebrands(Worker* worker, const CellularAutomaton* automaton) {
+    worker->outbox_count = 0;
+
+    for (size_t row = worker->first_row; row < worker->end_row; row++) {
+        const CellArray cell_arr = automaton->rows[row];
+        for (size_t col = 0; col < cell_arr.count; col++) {
+            if (cell_arr.elements[col].state != CELLSTATE_ONFIRE)
+                continue;
+
+            const BlockWind wind = windAt(automaton, row, col);
+            if (rngFloat(&worker->rng) >= firebrandChance(automaton, row, col, wind.speed))
+                continue;
+
+            const float temp_distance = spottingDistance(wind.speed);
+            const float sigma = temp_distance * 0.3f;
+            const float stochastic_value = rngFloat(&worker->rng) - 0.5f;
+            const float total_distance = temp_distance + sigma * stochastic_value * 2.0f;
+
+            const int dst_col = (int)col + ((int)roundf(total_distance) * wind.windX);
+            const int dst_row = (int)row + ((int)roundf(total_distance) * wind.windY);
+            if (dst_col < 0 || dst_col >= (int)cell_arr.count)
+                continue;
+            if (dst_row < 0 || dst_row >= (int)automaton->num_rows)
+                continue;
+
+            const Cell* dst_cell = &automaton->rows[dst_row].elements[dst_col];
+            if (dst_cell->state != CELLSTATE_NORMAL)
+                continue;
+
+            if (rngFloat(&worker->rng) >= ignitionSpotting(total_distance, dst_cell))
+                continue;
+
+            sendIgnition(worker, (size_t)dst_row, (size_t)dst_col);
+        }
+    }
+}
+
+// Lands the firebrands of every worker that fell in this band, then burns the band
+static void landAndBurn(Worker* worker, CellularAutomaton* automaton) {
+    const ParallelStepper* stepper = worker->stepper;
+
+    for (size_t other = 0; other < stepper->num_workers; other++) {
+        const Worker* sender = &stepper->workers[other];
+        for (size_t i = 0; i < sender->outbox_count; i++) {
+            const Ignition ignition = sender->outbox[i];
+            if (ignition.row < worker->first_row || ignition.row >= worker->end_row)
+                continue;
+
+            automaton->rows[ignition.row].elements[ignition.col].state = CELLSTATE_ONFIRE;
+        }
+    }
+
+    for (size_t row = worker->first_row; row < worker->end_row; row++) {
+        Cell* cells = automaton->rows[row].elements;
+        for (size_t col = 0; col < automaton->rows[row].count; col++)
+            burnCell(&cells[col]);
+    }
+}
+
+static void workerStep(Worker* worker, size_t step) {
+    ParallelStepper* stepper = worker->stepper;
+    const size_t read_plane = (stepper->current + step) & 1;
+    const size_t write_plane = read_plane ^ 1;
+
+    if (stepper->config.wind) {
+        if (worker->index == 0)
+            updateWindField(stepper->config.wind, stepper->config.step + step);
+        pthread_barrier_wait(&stepper->phase);
+    }
+
+    const CellularAutomaton in = planeView(stepper, read_plane);
+    CellularAutomaton out = planeView(stepper, write_plane);
+
+    float uniform_weights[8];
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (dx != 0 || dy != 0)
+                uniform_weights[neighbourIndex(dx, dy)] = windFactor(in.windX, in.windY, in.speed, dx, dy);
+        }
+    }
+
+    pullDirectSpread(worker, &in, &out, uniform_weights);
+    pthread_barrier_wait(&stepper->phase);
+
+    throwFirebrands(worker, &out);
+    pthread_barrier_wait(&stepper->phase);
+
+    landAndBurn(worker, &out);
+    pthread_barrier_wait(&stepper->phase);
+}
+
+static void* workerMain(void* userdata) {
+    Worker* worker = userdata;
+    ParallelStepper* stepper = worker->stepper;
+
+    pthread_mutex_lock(&stepper->launch_lock);
+    while (stepper->launch == LAUNCH_PENDING)
+        pthread_cond_wait(&stepper->launched, &stepper->launch_lock);
+    const bool abort = stepper->launch == LAUNCH_ABORT;
+    pthread_mutex_unlock(&stepper->launch_lock);
+    if (abort)
+        return nullptr;
+
+    if (worker->cpu >= 0 && !pinThreadToCpu((size_t)worker->cpu))
+        fprintf(stderr, "Couldn't pin worker %zu to cpu %ld\n", worker->index, worker->cpu);
+
+    // First touch from the pinned thread, so the band is allocated on its node
+    if (stepper->numa_aware)
+        touchBand(worker);
+    pthread_barrier_wait(&stepper->done);
+
+    for (;;) {
+        pthread_barrier_wait(&stepper->start);
+        if (stepper->quit)
+            break;
+
+        for (size_t step = 0; step < stepper->steps_to_run; step++)
+            workerStep(worker, step);
+
+        pthread_barrier_wait(&stepper->done);
+    }
+
+    return nullptr;
+}
+
+/// Spreads the workers over the nodes in order, so neighbouring bands share a node
+static void placeWorkers(ParallelStepper* stepper, const Topology* topology) {
+    const size_t num_workers = stepper->num_workers;
+
+    for (size_t index = 0; index < num_workers; index++) {
+        Worker* worker = &stepper->workers[index];
+        worker->cpu = -1;
+        if (!stepper->numa_aware)
+            continue;
+
+        const size_t node = index * topology->num_nodes / num_workers;
+        // Index of the first worker on this node
+        const size_t first = (node * num_workers + topology->num_nodes - 1) / topology->num_nodes;
+        const NumaNode* numa_node = &topology->nodes[node];
+        worker->cpu = (long)numa_node->cpus[(index - first) % numa_node->num_cpus];
+    }
+}
+
+static void destroyStepperMemory(ParallelStepper* stepper) {
+    pthread_barrier_destroy(&stepper->start);
+    pthread_barrier_destroy(&stepper->done);
+    pthread_barrier_destroy(&stepper->phase);
+    pthread_mutex_destroy(&stepper->launch_lock);
+    pthread_cond_destroy(&stepper->launched);
+
+    for (size_t plane = 0; plane < 2; plane++) {
+        munmap(stepper->planes[plane], stepper->plane_bytes);
+        free(stepper->rows[plane]);
+    }
+    free(stepper->workers);
+    free(stepper);
+}
+
+/// Sends the `started` workers home before they touch a barrier and frees the stepper
+static void abortLaunch(ParallelStepper* stepper, size_t started) {
+    pthread_mutex_lock(&stepper->launch_lock);
+    stepper->launch = LAUNCH_ABORT;
+    pthread_cond_broadcast(&stepper->launched);
+    pthread_mutex_unlock(&stepper->launch_lock);
+
+    for (size_t index = 0; index < started; index++)
+        pthread_join(stepper->workers[index].thread, nullptr);
+    destroyStepperMemory(stepper);
+}
+
+ParallelStepper* createParallelStepper(const CellularAutomaton* automaton, size_t num_threads, bool numa_aware, uint64_t seed) {
+    const size_t num_rows = automaton->num_rows;
+    const size_t num_columns = automaton->rows[0].count;
+    if (num_threads > num_rows)
+        num_threads = num_rows;
+    if (num_threads == 0)
+        num_threads = 1;
+
+    ParallelStepper* stepper = malloc(sizeof(ParallelStepper));
+    Worker* workers = calloc(num_threads, sizeof(Worker));
+    if (!stepper || !workers) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t plane_bytes = num_rows * num_columns * sizeof(Cell);
+    *stepper = (ParallelStepper) {
+        .current = 0,
+        .num_rows = num_rows,
+        .num_columns = num_columns,
+        .plane_bytes = plane_bytes,
+        .config = *automaton,
+        .source = automaton->rows[0].elements,
+        .numa_aware = numa_aware,
+        .workers = workers,
+        .num_workers = num_threads,
+        .steps_to_run = 0,
+        .quit = false,
+        .launch = LAUNCH_PENDING,
+    };
+    stepper->config.burnout = nullptr;
+    stepper->config.arena = nullptr;
+
+    for (size_t plane = 0; plane < 2; plane++) {
+        stepper->planes[plane] = allocatePlane(plane_bytes);
+        stepper->rows[plane] = rowTable(stepper->planes[plane], num_rows, num_columns);
+    }
+
+    // Without NUMA placement everything is touched from here, so it all lands on this node
+    if (!numa_aware) {
+        memcpy(stepper->planes[0], stepper->source, plane_bytes);
+        memcpy(stepper->planes[1], stepper->source, plane_bytes);
+    }
+
+    pthread_barrier_init(&stepper->start, nullptr, (unsigned)num_threads + 1);
+    pthread_barrier_init(&stepper->done, nullptr, (unsigned)num_threads + 1);
+    pthread_barrier_init(&stepper->phase, nullptr, (unsigned)num_threads);
+    pthread_mutex_init(&stepper->launch_lock, nullptr);
+    pthread_cond_init(&stepper->launched, nullptr);
+
+    Topology topology = readTopology();
+    placeWorkers(stepper, &topology);
+    destroyTopology(&topology);
+
+    for (size_t index = 0; index < num_threads; index++) {
+        Worker* worker = &workers[index];
+        worker->stepper = stepper;
+        worker->index = index;
+        worker->first_row = index * num_rows / num_threads;
+        worker->end_row = (index + 1) * num_rows / num_threads;
+        worker->rng = seedRng(seed * 0x100000001B3ull + index);
+
+        if (pthread_create(&worker->thread, nullptr, workerMain, worker) != 0) {
+            fprintf(stderr, "Failed to start worker thread %zu\n", index);
+            abortLaunch(stepper, index);
+            return nullptr;
+        }
+    }
+
+    pthread_mutex_lock(&stepper->launch_lock);
+    stepper->launch = LAUNCH_GO;
+    pthread_cond_broadcast(&stepper->launched);
+    pthread_mutex_unlock(&stepper->launch_lock);
+
+    // Wait for the first touch
+    pthread_barrier_wait(&stepper->done);
+    stepper->source = nullptr;
+    return stepper;
+}
+
+void runParallelSteps(ParallelStepper* stepper, size_t steps) {
+    if (steps == 0)
+        return;
+
+    stepper->steps_to_run = steps;
+    pthread_barrier_wait(&stepper->start);
+    pthread_barrier_wait(&stepper->done);
+
+    stepper->current = (stepper->current + steps) & 1;
+    stepper->config.step += steps;
+}
+
+CellularAutomaton parallelStepperState(const ParallelStepper* stepper) {
+    return planeView(stepper, stepper->current);
+}
+
+void destroyParallelStepper(ParallelStepper* stepper) {
+    stepper->quit = true;
+    pthread_barrier_wait(&stepper->start);
+
+    for (size_t index = 0; index < stepper->num_workers; index++) {
+        pthread_join(stepper->workers[index].thread, nullptr);
+        free(stepper->workers[index].outbox);
+    }
+
+    destroyStepperMemory(stepper);
+}
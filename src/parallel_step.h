@@ -0,0 +1,23 @@
+#pragma once
+#include "cell.h"
+#include <stdint.h>
+
+/// Runs the simulation on several threads, each owning a band of rows.
+/// With NUMA placement the bands are grouped per socket, every worker is pinned to a CPU of
+/// its socket and touches its own band first, so its memory ends up on the local node and
+/// only the rows at the edges of the bands are read across nodes.
+///
+/// Every worker draws from its own random generator, so the results match the sequential
+/// engine in distribution, not cell for cell.
+typedef struct ParallelStepper ParallelStepper;
+
+/// Copies the automaton into the stepper. The terrain and wind field are shared, not copied.
+/// Returns null if the threads couldn't be started. Running out of memory exits, like everywhere else.
+ParallelStepper* createParallelStepper(const CellularAutomaton* automaton, size_t num_threads, bool numa_aware, uint64_t seed);
+void destroyParallelStepper(ParallelStepper* stepper);
+
+void runParallelSteps(ParallelStepper* stepper, size_t steps);
+
+/// View of the current state, owned by the stepper, so don't destroy it.
+/// It is only valid until the next call to `runParallelSteps`.
+CellularAutomaton parallelStepperState(const ParallelStepper* stepper);
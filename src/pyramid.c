@@ -0,0 +1,153 @@
+#include "pyramid.h"
+#include "burnout_cell.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+static uint8_t cellShade(const Cell* cell) {
+    switch (cell->state) {
+    case CELLSTATE_ONFIRE:
+        return SHADE_ONFIRE;
+    case CELLSTATE_BURNT:
+        return SHADE_BURNT;
+    default:
+        return (uint8_t)vegTypeIndex(cell->type);
+    }
+}
+
+/// Shade of the block at (row, col) of `level` from its up to 4 cells in the level below
+static uint8_t blockShade(const GridPyramid* pyramid, size_t level, size_t row, size_t col) {
+    const uint8_t* below = pyramid->levels[level - 1];
+    const size_t below_rows = pyramid->rows[level - 1];
+    const size_t below_cols = pyramid->cols[level - 1];
+    const size_t top = 2 * row;
+    const size_t left = 2 * col;
+
+    const uint8_t first = below[top * below_cols + left];
+    uint8_t shade = first;
+    for (size_t r = top; r < top + 2 && r < below_rows; r++) {
+        for (size_t c = left; c < left + 2 && c < below_cols; c++) {
+            if (below[r * below_cols + c] > shade)
+                shade = below[r * below_cols + c];
+        }
+    }
+
+    return shade >= SHADE_BURNT ? shade : first;
+}
+
+static void shadeAll(GridPyramid* pyramid, const CellularAutomaton* automaton) {
+    uint8_t* cells = pyramid->levels[0];
+    for (size_t row = 0; row < automaton->num_rows; row++) {
+        const CellArray arr = automaton->rows[row];
+        for (size_t col = 0; col < arr.count; col++)
+            cells[row * arr.count + col] = cellShade(&arr.elements[col]);
+    }
+
+    for (size_t level = 1; level < pyramid->num_levels; level++) {
+        for (size_t row = 0; row < pyramid->rows[level]; row++) {
+            for (size_t col = 0; col < pyramid->cols[level]; col++)
+                pyramid->levels[level][row * pyramid->cols[level] + col] = blockShade(pyramid, level, row, col);
+        }
+    }
+}
+
+GridPyramid createGridPyramid(const CellularAutomaton* automaton) {
+    GridPyramid pyramid = {0};
+
+    size_t rows = automaton->num_rows;
+    size_t cols = automaton->rows[0].count;
+    for (;;) {
+        uint8_t* level = malloc(rows * cols);
+        if (!level) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        pyramid.levels[pyramid.num_levels] = level;
+        pyramid.rows[pyramid.num_levels] = rows;
+        pyramid.cols[pyramid.num_levels] = cols;
+        pyramid.num_levels++;
+        if (rows == 1 && cols == 1)
+            break;
+
+        rows = (rows + 1) / 2;
+        cols = (cols + 1) / 2;
+    }
+
+    shadeAll(&pyramid, automaton);
+
+    // Start out tracking what is burning already
+    pyramid.step = automaton->step;
+    updateGridPyramid(&pyramid, automaton);
+    return pyramid;
+}
+
+void destroyGridPyramid(GridPyramid* pyramid) {
+    for (size_t level = 0; level < pyramid->num_levels; level++)
+        free(pyramid->levels[level]);
+    free(pyramid->burning);
+    *pyramid = (GridPyramid){0};
+}
+
+/// Shades one cell again and carries the change up the levels
+static void shadeCell(GridPyramid* pyramid, const CellularAutomaton* automaton, size_t index) {
+    const size_t num_columns = pyramid->cols[0];
+    size_t row = index / num_columns;
+    size_t col = index % num_columns;
+
+    const uint8_t shade = cellShade(&automaton->rows[row].elements[col]);
+    if (pyramid->levels[0][index] == shade)
+        return;
+    pyramid->levels[0][index] = shade;
+
+    for (size_t level = 1; level < pyramid->num_levels; level++) {
+        row /= 2;
+        col /= 2;
+        uint8_t* block = &pyramid->levels[level][row * pyramid->cols[level] + col];
+        const uint8_t block_shade = blockShade(pyramid, level, row, col);
+        if (*block == block_shade)
+            return;
+        *block = block_shade;
+    }
+}
+
+static void trackBurning(GridPyramid* pyramid, size_t index) {
+    if (pyramid->num_burning == pyramid->burning_capacity) {
+        pyramid->burning_capacity = pyramid->burning_capacity ? 2 * pyramid->burning_capacity : 1024;
+        pyramid->burning = realloc(pyramid->burning, pyramid->burning_capacity * sizeof(size_t));
+        if (!pyramid->burning) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pyramid->burning[pyramid->num_burning++] = index;
+}
+
+void skipGridPyramidSteps(GridPyramid* pyramid, size_t steps) {
+    pyramid->step += steps;
+}
+
+void updateGridPyramid(GridPyramid* pyramid, const CellularAutomaton* automaton) {
+    const BurnoutWheel* wheel = automaton->burnout;
+    const bool missed_steps = automaton->step > pyramid->step + 1 || automaton->step < pyramid->step;
+    pyramid->step = automaton->step;
+    if (!wheel || missed_steps) {
+        shadeAll(pyramid, automaton);
+        pyramid->num_burning = 0;
+        if (!wheel)
+            return;
+    }
+
+    // Cells that burnt out since the last update
+    for (size_t i = 0; i < pyramid->num_burning; i++)
+        shadeCell(pyramid, automaton, pyramid->burning[i]);
+
+    // Every burning cell waits in the wheel, including the ones that ignited since the last update
+    pyramid->num_burning = 0;
+    for (size_t slot = 0; slot < BURNOUT_WHEEL_SLOTS; slot++) {
+        for (size_t index = wheel->heads[slot]; index != BURNOUT_WHEEL_EMPTY; index = wheel->next[index]) {
+            shadeCell(pyramid, automaton, index);
+            trackBurning(pyramid, index);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "cell.h"
+#include <stdint.h>
+
+// Enough levels for any grid that fits in memory
+#define PYRAMID_MAX_LEVELS 48
+
+/// What the viewer draws for a cell, ordered so that burning beats burnt beats unburnt when
+/// blocks of cells are merged. The unburnt shades follow `vegTypeIndex`.
+typedef enum CellShade {
+    SHADE_BROADLEAVES,
+    SHADE_SHRUBS,
+    SHADE_GRASSLAND,
+    SHADE_FIREPRONE,
+    SHADE_AGROFORESTRY,
+    SHADE_NOTFIREPRONE,
+    SHADE_BURNT,
+    SHADE_ONFIRE,
+
+    SHADE_LAST,
+} CellShade;
+
+/// Level of detail pyramid of the shades of an automaton, so a zoomed out view reads one shade
+/// per screen pixel instead of every cell under it.
+/// Level 0 has one shade per cell and every level above has one per 2x2 block of the level below,
+/// rounded up. A block is burning if any of its cells is, else burnt if any is, else it takes the
+/// shade of its top left cell, so fronts and scars stay visible at every zoom.
+typedef struct GridPyramid {
+    uint8_t* levels[PYRAMID_MAX_LEVELS];
+    size_t rows[PYRAMID_MAX_LEVELS];
+    size_t cols[PYRAMID_MAX_LEVELS];
+    size_t num_levels;
+    // Cells that were burning at the last update, row * num_columns + col
+    size_t* burning;
+    size_t num_burning;
+    size_t burning_capacity;
+    // Step of the automaton at the last update, plus the idle steps skipped since
+    size_t step;
+} GridPyramid;
+
+GridPyramid createGridPyramid(const CellularAutomaton* automaton);
+void destroyGridPyramid(GridPyramid* pyramid);
+
+/// Brings the pyramid up to date with the automaton.
+/// With a burnout wheel only the cells burning now or at the last update can have changed, so
+/// only those are shaded again, each walking up the levels until a block keeps its shade.
+/// That only holds when it is called after every step: a cell can ignite and burn out within two
+/// steps and never be in the wheel at an update. So when the automaton is more than one step
+/// further than at the last update, not counting the idle steps passed to `skipGridPyramidSteps`,
+/// every cell is shaded again, like without a wheel.
+void updateGridPyramid(GridPyramid* pyramid, const CellularAutomaton* automaton);
+
+/// Tells the pyramid that `steps` steps where nothing changed went by, e.g. from `skipIdleSteps`,
+/// so they don't make the next update shade every cell again
+void skipGridPyramidSteps(GridPyramid* pyramid, size_t steps);
+
+static inline CellShade pyramidShade(const GridPyramid* pyramid, size_t level, size_t row, size_t col) {
+    return (CellShade)pyramid->levels[level][row * pyramid->cols[level] + col];
+}
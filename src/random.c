@@ -0,0 +1,5 @@
+#include "random.h"
+
+thread_local Rng simulation_rng = {
+    .state = 0x2545F4914F6CDD1Dull,
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+
+/// Small per-thread random number generator (xorshift64*), for the engines that run
+/// on several threads at once, where `rand()` would both serialize and share its state.
+typedef struct Rng {
+    uint64_t state;
+} Rng;
+
+/// Seeds through splitmix64, so neighbouring seeds give unrelated streams
+static inline Rng seedRng(uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+
+    // xorshift gets stuck on 0
+    return (Rng) {
+        .state = z ? z : 1,
+    };
+}
+
+static inline uint64_t rngNext(Rng* rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1Dull;
+}
+
+/// Random number between 0 and 1, like `(float)rand() / (float)RAND_MAX`
+static inline float rngFloat(Rng* rng) {
+    // The top 24 bits fit exactly in a float
+    return (float)(rngNext(rng) >> 40) * (1.0f / 16777215.0f);
+}
+
+/// The generator the spreading phases draw from. There is one per thread, so simulations
+/// running on different threads neither share nor serialize on it, which they would with `rand`.
+/// Threads that never seed it all start from the same fixed state, like `rand` without `srand`.
+extern thread_local Rng simulation_rng;
+
+static inline void seedSimulation(uint64_t seed) {
+    simulation_rng = seedRng(seed);
+}
+
+/// Random number between 0 and 1 from the generator of this thread
+static inline float simulationRandom(void) {
+    return rngFloat(&simulation_rng);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Messages between the scenario server and its clients, over a Unix domain socket.
+ * Both ends are on the same machine, so everything is in its native byte order.
+ *
+ * A client sends any number of requests, each a ScenarioRequest followed by its ignitions.
+ * For every request the server streams a SCENARIO_FRAME_REALIZATION frame per finished realization,
+ * in the order they finish, and then one SCENARIO_FRAME_RESULT frame, or a SCENARIO_FRAME_ERROR
+ * frame with a message if the request was refused.
+ */
+
+#define SCENARIO_MAGIC 0x57464952u // "WFIR"
+
+// Most ignitions and realizations a single request may ask for
+#define SCENARIO_MAX_IGNITIONS 4096
+#define SCENARIO_MAX_REALIZATIONS 100000
+
+typedef struct ScenarioRequest {
+    uint32_t magic;
+    uint32_t grid; // index of the grid, in the order the server loaded them
+    uint64_t id;   // chosen by the client, echoed in every frame about this request
+    uint64_t seed;
+    int32_t windX;
+    int32_t windY;
+    uint32_t speed;
+    uint32_t steps;
+    uint32_t realizations;
+    uint32_t num_ignitions; // followed by this many ScenarioIgnition
+} ScenarioRequest;
+
+typedef struct ScenarioIgnition {
+    uint32_t row;
+    uint32_t col;
+} ScenarioIgnition;
+
+typedef enum ScenarioFrameType {
+    SCENARIO_FRAME_REALIZATION = 1,
+    SCENARIO_FRAME_RESULT = 2,
+    SCENARIO_FRAME_ERROR = 3,
+} ScenarioFrameType;
+
+typedef struct ScenarioFrame {
+    uint32_t magic;
+    uint32_t type;          // ScenarioFrameType
+    uint64_t id;
+    uint64_t payload_bytes; // what follows the frame
+} ScenarioFrame;
+
+typedef struct ScenarioRealization {
+    uint32_t realization;
+    uint32_t steps;
+    uint64_t burning;
+    uint64_t burnt; // cells the fire reached, burnt or still burning
+} ScenarioRealization;
+
+/// Followed by the burned mask, the fraction of realizations each cell burned in as
+/// num_rows * num_columns floats, and then the mean arrival times, the mean step each cell
+/// caught fire at over the realizations it burned in, as floats, -1 where it never burned
+typedef struct ScenarioResult {
+    uint32_t num_rows;
+    uint32_t num_columns;
+    uint32_t realizations;
+    uint32_t steps;
+    double mean_burnt;   // cells burnt or burning at the end, over the realizations
+    double stddev_burnt;
+    uint32_t batch_size; // requests that shared the realizations of this one
+    uint32_t reserved;
+} ScenarioResult;
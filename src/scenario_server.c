@@ -0,0 +1,717 @@
+#include "scenario_server.h"
+#include "cell.h"
+#include "random.h"
+#include "scenario_protocol.h"
+#include "wildfire.h"
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define ARRIVAL_NEVER UINT32_MAX
+// A client that doesn't read its results for this long is dropped
+#define SEND_TIMEOUT_SECONDS 5
+
+typedef struct Connection {
+    int fd;
+    pthread_mutex_t write_lock; // frames of different requests must not interleave
+    bool broken;                // a send failed or timed out, nothing more is sent
+    struct ScenarioServer* server;
+    size_t refs; // the thread reading requests and every request still running
+    struct Connection* next;
+} Connection;
+
+/// One request in a batch, with what its realizations added up to so far
+typedef struct Member {
+    Connection* connection;
+    ScenarioRequest request;
+    size_t done;
+    uint32_t* burned;    // realizations each cell burned in
+    double* arrival_sum; // summed over those realizations
+    double sum_burnt;
+    double sum_squared_burnt;
+} Member;
+
+/// Requests for the same scenario, run as one
+typedef struct Batch {
+    uint32_t grid;
+    int windX;
+    int windY;
+    WindSpeed speed;
+    uint64_t seed;
+    ScenarioIgnition* ignitions;
+    size_t num_ignitions;
+
+    size_t steps;        // the most any member asked for
+    size_t realizations; // likewise
+    size_t next_realization;
+    size_t finished_realizations;
+
+    Member* members;
+    size_t num_members;
+    size_t members_capacity;
+
+    pthread_mutex_t lock; // the members, once the batch has started
+    struct Batch* next;
+} Batch;
+
+typedef struct Worker {
+    struct ScenarioServer* server;
+    pthread_t thread;
+    WildfireContext** contexts; // one clone per grid
+    uint32_t* arrival;          // step each cell caught fire at in the current realization
+} Worker;
+
+typedef struct ScenarioServer {
+    WildfireContext** grids;
+    size_t num_grids;
+    size_t max_cells;
+
+    Worker* workers;
+    size_t num_workers;
+
+    // Batches with realizations that haven't started, the ones at the front have started some
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_ready;
+    Batch* queue_head;
+    Batch* queue_tail;
+    bool quit;
+
+    pthread_mutex_t connections_lock;
+    pthread_cond_t connections_closed;
+    Connection* connections;
+} ScenarioServer;
+
+static void retainConnection(Connection* connection) {
+    pthread_mutex_lock(&connection->server->connections_lock);
+    connection->refs++;
+    pthread_mutex_unlock(&connection->server->connections_lock);
+}
+
+/// Closes the connection once the client is gone and nothing has results left for it
+static void releaseConnection(Connection* connection) {
+    ScenarioServer* server = connection->server;
+
+    pthread_mutex_lock(&server->connections_lock);
+    const bool last = --connection->refs == 0;
+    if (last) {
+        Connection** link = &server->connections;
+        while (*link != connection)
+            link = &(*link)->next;
+        *link = connection->next;
+        pthread_cond_broadcast(&server->connections_closed);
+    }
+    pthread_mutex_unlock(&server->connections_lock);
+
+    if (!last)
+        return;
+    pthread_mutex_destroy(&connection->write_lock);
+    close(connection->fd);
+    free(connection);
+}
+
+static bool writeAll(int fd, const void* data, size_t bytes) {
+    const uint8_t* left = data;
+    while (bytes > 0) {
+        const ssize_t written = send(fd, left, bytes, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        left += written;
+        bytes -= (size_t)written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t bytes) {
+    uint8_t* left = data;
+    while (bytes > 0) {
+        const ssize_t received = recv(fd, left, bytes, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        left += received;
+        bytes -= (size_t)received;
+    }
+    return true;
+}
+
+/// Sends a frame and its payload in up to two parts. A client that went away is not an error
+/// for the server, its results are just dropped. So is a client that stopped reading: once a send
+/// times out the connection is shut down, so it holds up a worker at most once.
+static void sendFrame(Connection* connection, ScenarioFrameType type, uint64_t id,
+                      const void* first, size_t first_bytes, const void* second, size_t second_bytes) {
+    const ScenarioFrame frame = {
+        .magic = SCENARIO_MAGIC,
+        .type = type,
+        .id = id,
+        .payload_bytes = first_bytes + second_bytes,
+    };
+
+    pthread_mutex_lock(&connection->write_lock);
+    if (!connection->broken) {
+        const bool sent = writeAll(connection->fd, &frame, sizeof(frame))
+                          && writeAll(connection->fd, first, first_bytes)
+                          && writeAll(connection->fd, second, second_bytes);
+        if (!sent) {
+            // Also wakes the reader of the connection
+            connection->broken = true;
+            shutdown(connection->fd, SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&connection->write_lock);
+}
+
+static void sendError(Connection* connection, uint64_t id, const char* message) {
+    sendFrame(connection, SCENARIO_FRAME_ERROR, id, message, strlen(message), nullptr, 0);
+}
+
+/// Summarizes a member that has all its realizations. The planes are malloc'ed, fraction burned then mean arrival.
+static float* buildResult(const ScenarioServer* server, const Member* member, size_t batch_size, ScenarioResult* result) {
+    const WildfireView view = wildfireState(server->grids[member->request.grid]);
+    const size_t num_cells = view.num_rows * view.num_columns;
+    const double realizations = (double)member->request.realizations;
+
+    float* planes = malloc(2 * num_cells * sizeof(float));
+    if (!planes) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t cell = 0; cell < num_cells; cell++) {
+        const uint32_t burned = member->burned[cell];
+        planes[cell] = (float)((double)burned / realizations);
+        planes[num_cells + cell] = burned ? (float)(member->arrival_sum[cell] / (double)burned) : -1.0f;
+    }
+
+    const double mean = member->sum_burnt / realizations;
+    const double variance = member->sum_squared_burnt / realizations - mean * mean;
+    *result = (ScenarioResult){
+        .num_rows = (uint32_t)view.num_rows,
+        .num_columns = (uint32_t)view.num_columns,
+        .realizations = member->request.realizations,
+        .steps = member->request.steps,
+        .mean_burnt = mean,
+        .stddev_burnt = variance > 0.0 ? sqrt(variance) : 0.0,
+        .batch_size = (uint32_t)batch_size,
+    };
+    return planes;
+}
+
+/// What a realization has to send to one member, gathered under the batch lock and sent after it
+typedef struct Outgoing {
+    Connection* connection;
+    uint64_t id;
+    ScenarioRealization frame;
+    ScenarioResult result;
+    float* planes; // null until the member has all its realizations
+    size_t planes_bytes;
+} Outgoing;
+
+static void destroyBatch(Batch* batch) {
+    for (size_t index = 0; index < batch->num_members; index++) {
+        free(batch->members[index].burned);
+        free(batch->members[index].arrival_sum);
+        releaseConnection(batch->members[index].connection);
+    }
+    pthread_mutex_destroy(&batch->lock);
+    free(batch->members);
+    free(batch->ignitions);
+    free(batch);
+}
+
+/// Adds what the realization looks like at `step` to every member that asked for that many steps
+static void collectRealization(ScenarioServer* server, Batch* batch, size_t realization, size_t step,
+                               const uint32_t* arrival, const WildfireView* view) {
+    const size_t num_cells = view->num_rows * view->num_columns;
+    size_t burnt = 0;
+    size_t burning = 0;
+    for (size_t cell = 0; cell < num_cells; cell++) {
+        burnt += arrival[cell] != ARRIVAL_NEVER;
+        burning += view->cells[cell].state == CELLSTATE_ONFIRE;
+    }
+
+    Outgoing* outgoing = malloc(batch->num_members * sizeof(Outgoing));
+    if (!outgoing) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t num_outgoing = 0;
+
+    // Only the tallies are updated under the lock. Sending can block on a client that stopped
+    // reading, and the other workers of the batch must not wait on that.
+    pthread_mutex_lock(&batch->lock);
+    for (size_t index = 0; index < batch->num_members; index++) {
+        Member* member = &batch->members[index];
+        if (member->request.steps != step || realization >= member->request.realizations)
+            continue;
+
+        for (size_t cell = 0; cell < num_cells; cell++) {
+            if (arrival[cell] == ARRIVAL_NEVER)
+                continue;
+            member->burned[cell]++;
+            member->arrival_sum[cell] += arrival[cell];
+        }
+        member->sum_burnt += (double)burnt;
+        member->sum_squared_burnt += (double)burnt * (double)burnt;
+        member->done++;
+
+        Outgoing* out = &outgoing[num_outgoing++];
+        *out = (Outgoing){
+            .connection = member->connection,
+            .id = member->request.id,
+            .frame = {
+                .realization = (uint32_t)realization,
+                .steps = (uint32_t)step,
+                .burning = burning,
+                .burnt = burnt,
+            },
+        };
+        if (member->done == member->request.realizations) {
+            out->planes = buildResult(server, member, batch->num_members, &out->result);
+            out->planes_bytes = 2 * num_cells * sizeof(float);
+        }
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    // The connections stay open until the batch is destroyed, which waits for this realization
+    for (size_t index = 0; index < num_outgoing; index++) {
+        Outgoing* out = &outgoing[index];
+        sendFrame(out->connection, SCENARIO_FRAME_REALIZATION, out->id, &out->frame, sizeof(out->frame), nullptr, 0);
+        if (out->planes) {
+            sendFrame(out->connection, SCENARIO_FRAME_RESULT, out->id,
+                      &out->result, sizeof(out->result), out->planes, out->planes_bytes);
+            free(out->planes);
+        }
+    }
+    free(outgoing);
+}
+
+static void runRealization(Worker* worker, Batch* batch, size_t realization) {
+    WildfireContext* context = worker->contexts[batch->grid];
+    seedSimulation(batch->seed + realization * 0x9E3779B97F4A7C15ull);
+
+    wildfireReset(context);
+    wildfireSetWind(context, batch->windX, batch->windY, batch->speed);
+    for (size_t index = 0; index < batch->num_ignitions; index++)
+        wildfireIgnite(context, batch->ignitions[index].row, batch->ignitions[index].col);
+
+    WildfireView view = wildfireState(context);
+    const size_t num_cells = view.num_rows * view.num_columns;
+    for (size_t cell = 0; cell < num_cells; cell++)
+        worker->arrival[cell] = view.cells[cell].state != CELLSTATE_NORMAL ? 0 : ARRIVAL_NEVER;
+
+    size_t step = 0;
+    for (;;) {
+        // Members stop at different steps, so the realization stops at each of them
+        size_t next_stop = batch->steps;
+        for (size_t index = 0; index < batch->num_members; index++) {
+            const size_t steps = batch->members[index].request.steps;
+            if (steps > step && steps < next_stop)
+                next_stop = steps;
+        }
+
+        // `step` is a stop where nothing ignited in between, some member might still want it
+        collectRealization(worker->server, batch, realization, step, worker->arrival, &view);
+        if (step >= batch->steps)
+            break;
+
+        while (step < next_stop) {
+            step += wildfireAdvance(context, next_stop - step);
+
+            view = wildfireState(context);
+            for (size_t cell = 0; cell < num_cells; cell++) {
+                if (worker->arrival[cell] == ARRIVAL_NEVER && view.cells[cell].state != CELLSTATE_NORMAL)
+                    worker->arrival[cell] = (uint32_t)step;
+            }
+        }
+    }
+}
+
+static void* workerMain(void* userdata) {
+    Worker* worker = userdata;
+    ScenarioServer* server = worker->server;
+
+    for (;;) {
+        pthread_mutex_lock(&server->queue_lock);
+        while (!server->queue_head && !server->quit)
+            pthread_cond_wait(&server->queue_ready, &server->queue_lock);
+        if (server->quit) {
+            pthread_mutex_unlock(&server->queue_lock);
+            break;
+        }
+
+        // Once a realization has started, nothing is added to the batch any more
+        Batch* batch = server->queue_head;
+        const size_t realization = batch->next_realization++;
+        if (batch->next_realization == batch->realizations) {
+            server->queue_head = batch->next;
+            if (!server->queue_head)
+                server->queue_tail = nullptr;
+        }
+        pthread_mutex_unlock(&server->queue_lock);
+
+        runRealization(worker, batch, realization);
+
+        pthread_mutex_lock(&batch->lock);
+        const bool last = ++batch->finished_realizations == batch->realizations;
+        pthread_mutex_unlock(&batch->lock);
+        if (last)
+            destroyBatch(batch);
+    }
+
+    return nullptr;
+}
+
+static bool sameScenario(const Batch* batch, const ScenarioRequest* request, const ScenarioIgnition* ignitions) {
+    return batch->next_realization == 0
+        && batch->grid == request->grid
+        && batch->windX == request->windX
+        && batch->windY == request->windY
+        && batch->speed == (WindSpeed)request->speed
+        && batch->seed == request->seed
+        && batch->num_ignitions == request->num_ignitions
+        && memcmp(batch->ignitions, ignitions, request->num_ignitions * sizeof(ScenarioIgnition)) == 0;
+}
+
+static void addMember(Batch* batch, Connection* connection, const ScenarioRequest* request, size_t num_cells) {
+    if (batch->num_members == batch->members_capacity) {
+        const size_t capacity = batch->members_capacity ? batch->members_capacity * 2 : 4;
+        Member* members = realloc(batch->members, capacity * sizeof(Member));
+        if (!members) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        batch->members = members;
+        batch->members_capacity = capacity;
+    }
+
+    Member* member = &batch->members[batch->num_members++];
+    *member = (Member) {
+        .connection = connection,
+        .request = *request,
+        .burned = calloc(num_cells, sizeof(uint32_t)),
+        .arrival_sum = calloc(num_cells, sizeof(double)),
+    };
+    if (!member->burned || !member->arrival_sum) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    retainConnection(connection);
+
+    if (request->steps > batch->steps)
+        batch->steps = request->steps;
+    if (request->realizations > batch->realizations)
+        batch->realizations = request->realizations;
+}
+
+/// Joins a waiting batch of the same scenario, or queues a new one
+static void enqueueRequest(ScenarioServer* server, Connection* connection, const ScenarioRequest* request,
+                           ScenarioIgnition* ignitions) {
+    const WildfireView view = wildfireState(server->grids[request->grid]);
+    const size_t num_cells = view.num_rows * view.num_columns;
+
+    pthread_mutex_lock(&server->queue_lock);
+    for (Batch* batch = server->queue_head; batch; batch = batch->next) {
+        if (!sameScenario(batch, request, ignitions))
+            continue;
+
+        addMember(batch, connection, request, num_cells);
+        pthread_mutex_unlock(&server->queue_lock);
+        free(ignitions);
+        return;
+    }
+
+    Batch* batch = calloc(1, sizeof(Batch));
+    if (!batch) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *batch = (Batch) {
+        .grid = request->grid,
+        .windX = request->windX,
+        .windY = request->windY,
+        .speed = (WindSpeed)request->speed,
+        .seed = request->seed,
+        .ignitions = ignitions,
+        .num_ignitions = request->num_ignitions,
+    };
+    pthread_mutex_init(&batch->lock, nullptr);
+    addMember(batch, connection, request, num_cells);
+
+    if (server->queue_tail)
+        server->queue_tail->next = batch;
+    else
+        server->queue_head = batch;
+    server->queue_tail = batch;
+
+    pthread_cond_broadcast(&server->queue_ready);
+    pthread_mutex_unlock(&server->queue_lock);
+}
+
+/// Returns the reason the request can't be run, or null if it can
+static const char* checkRequest(const ScenarioServer* server, const ScenarioRequest* request, const ScenarioIgnition* ignitions) {
+    if (request->grid >= server->num_grids)
+        return "No such grid";
+    if (request->windX < -1 || request->windX > 1 || request->windY < -1 || request->windY > 1)
+        return "windX and windY have to be between -1 and 1";
+    if (request->speed >= WIND_LAST)
+        return "speed has to be between 0 and 4";
+    if (request->realizations == 0 || request->realizations > SCENARIO_MAX_REALIZATIONS)
+        return "Too many or too few realizations";
+
+    const WildfireView view = wildfireState(server->grids[request->grid]);
+    for (size_t index = 0; index < request->num_ignitions; index++) {
+        if (ignitions[index].row >= view.num_rows || ignitions[index].col >= view.num_columns)
+            return "Ignition outside the grid";
+    }
+    return nullptr;
+}
+
+static void* connectionMain(void* userdata) {
+    Connection* connection = userdata;
+    ScenarioServer* server = connection->server;
+
+    for (;;) {
+        ScenarioRequest request;
+        if (!readAll(connection->fd, &request, sizeof(request)))
+            break;
+        if (request.magic != SCENARIO_MAGIC || request.num_ignitions > SCENARIO_MAX_IGNITIONS) {
+            sendError(connection, request.id, "Malformed request");
+            break;
+        }
+
+        ScenarioIgnition* ignitions = malloc((request.num_ignitions ? request.num_ignitions : 1) * sizeof(ScenarioIgnition));
+        if (!ignitions) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        if (!readAll(connection->fd, ignitions, request.num_ignitions * sizeof(ScenarioIgnition))) {
+            free(ignitions);
+            break;
+        }
+
+        const char* error = checkRequest(server, &request, ignitions);
+        if (error) {
+            sendError(connection, request.id, error);
+            free(ignitions);
+            continue;
+        }
+
+        enqueueRequest(server, connection, &request, ignitions);
+    }
+
+    // The connection stays open for the results still on their way
+    shutdown(connection->fd, SHUT_RD);
+    releaseConnection(connection);
+    return nullptr;
+}
+
+static int openSocket(const char* path) {
+    struct sockaddr_un address = {
+        .sun_family = AF_UNIX,
+    };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "ERROR: socket path \"%s\" is too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    // Left behind by a server that didn't shut down cleanly
+    unlink(path);
+    if (bind(fd, (const struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        fprintf(stderr, "ERROR: couldn't listen on \"%s\": %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void acceptConnection(ScenarioServer* server, int listen_fd) {
+    const int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0)
+        return;
+
+    Connection* connection = malloc(sizeof(Connection));
+    if (!connection) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *connection = (Connection) {
+        .fd = fd,
+        .server = server,
+        .refs = 1,
+    };
+    pthread_mutex_init(&connection->write_lock, nullptr);
+
+    const struct timeval send_timeout = {.tv_sec = SEND_TIMEOUT_SECONDS};
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout)) != 0)
+        perror("setsockopt");
+
+    pthread_mutex_lock(&server->connections_lock);
+    connection->next = server->connections;
+    server->connections = connection;
+    pthread_mutex_unlock(&server->connections_lock);
+
+    // The reader cleans up after itself, so nobody joins it
+    pthread_t reader;
+    if (pthread_create(&reader, nullptr, connectionMain, connection) != 0) {
+        fputs("Failed to start a connection thread\n", stderr);
+        releaseConnection(connection);
+        return;
+    }
+    pthread_detach(reader);
+}
+
+static bool loadGrids(ScenarioServer* server, const ScenarioServerOptions* options) {
+    server->grids = calloc(options->num_grids, sizeof(WildfireContext*));
+    if (!server->grids) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t grid = 0; grid < options->num_grids; grid++) {
+        server->grids[grid] = wildfireCreate(options->grid_paths[grid], nullptr);
+        if (!server->grids[grid])
+            return false;
+        server->num_grids++;
+
+        const WildfireView view = wildfireState(server->grids[grid]);
+        if (view.num_rows * view.num_columns > server->max_cells)
+            server->max_cells = view.num_rows * view.num_columns;
+    }
+    return true;
+}
+
+static bool startWorkers(ScenarioServer* server, size_t num_workers) {
+    if (num_workers == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = online > 0 ? (size_t)online : 1;
+    }
+
+    server->workers = calloc(num_workers, sizeof(Worker));
+    if (!server->workers) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t index = 0; index < num_workers; index++) {
+        Worker* worker = &server->workers[index];
+        worker->server = server;
+        worker->contexts = malloc(server->num_grids * sizeof(WildfireContext*));
+        worker->arrival = malloc(server->max_cells * sizeof(uint32_t));
+        if (!worker->contexts || !worker->arrival) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t grid = 0; grid < server->num_grids; grid++) {
+            worker->contexts[grid] = wildfireClone(server->grids[grid]);
+            if (!worker->contexts[grid])
+                return false;
+        }
+
+        if (pthread_create(&worker->thread, nullptr, workerMain, worker) != 0) {
+            fprintf(stderr, "Failed to start worker thread %zu\n", index);
+            return false;
+        }
+        server->num_workers++;
+    }
+    return true;
+}
+
+static void stopServer(ScenarioServer* server) {
+    pthread_mutex_lock(&server->queue_lock);
+    server->quit = true;
+    pthread_cond_broadcast(&server->queue_ready);
+    pthread_mutex_unlock(&server->queue_lock);
+
+    for (size_t index = 0; index < server->num_workers; index++)
+        pthread_join(server->workers[index].thread, nullptr);
+
+    // With the workers gone, whatever is still queued will never finish
+    while (server->queue_head) {
+        Batch* batch = server->queue_head;
+        server->queue_head = batch->next;
+        destroyBatch(batch);
+    }
+
+    // Wakes up the readers blocked on their clients and waits for them to clean up
+    pthread_mutex_lock(&server->connections_lock);
+    for (Connection* connection = server->connections; connection; connection = connection->next)
+        shutdown(connection->fd, SHUT_RDWR);
+    while (server->connections)
+        pthread_cond_wait(&server->connections_closed, &server->connections_lock);
+    pthread_mutex_unlock(&server->connections_lock);
+
+    if (server->workers) {
+        for (size_t index = 0; index < server->num_workers; index++) {
+            Worker* worker = &server->workers[index];
+            for (size_t grid = 0; grid < server->num_grids; grid++)
+                wildfireDestroy(worker->contexts[grid]);
+            free(worker->contexts);
+            free(worker->arrival);
+        }
+    }
+    free(server->workers);
+
+    for (size_t grid = 0; grid < server->num_grids; grid++)
+        wildfireDestroy(server->grids[grid]);
+    free(server->grids);
+
+    pthread_mutex_destroy(&server->queue_lock);
+    pthread_cond_destroy(&server->queue_ready);
+    pthread_mutex_destroy(&server->connections_lock);
+    pthread_cond_destroy(&server->connections_closed);
+}
+
+bool runScenarioServer(const ScenarioServerOptions* options, volatile sig_atomic_t* stop) {
+    ScenarioServer server = {
+        .grids = nullptr,
+    };
+    pthread_mutex_init(&server.queue_lock, nullptr);
+    pthread_cond_init(&server.queue_ready, nullptr);
+    pthread_mutex_init(&server.connections_lock, nullptr);
+    pthread_cond_init(&server.connections_closed, nullptr);
+
+    if (!loadGrids(&server, options) || !startWorkers(&server, options->num_workers)) {
+        stopServer(&server);
+        return false;
+    }
+
+    const int listen_fd = openSocket(options->socket_path);
+    if (listen_fd < 0) {
+        stopServer(&server);
+        return false;
+    }
+    fprintf(stderr, "Serving %zu grid(s) with %zu workers on %s\n", server.num_grids, server.num_workers, options->socket_path);
+
+    while (!*stop) {
+        struct pollfd fd = {
+            .fd = listen_fd,
+            .events = POLLIN,
+        };
+        // Wakes up now and then to look at `stop`
+        if (poll(&fd, 1, 200) > 0)
+            acceptConnection(&server, listen_fd);
+    }
+
+    close(listen_fd);
+    unlink(options->socket_path);
+    stopServer(&server);
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <signal.h>
+#include <stddef.h>
+
+/*
+ * Long running server for many short what-if scenarios on the same grids.
+ *
+ * The grids are loaded once, then every worker thread clones a context of each, sharing the
+ * terrain. Requests come in over a Unix domain socket (see scenario_protocol.h) and wait in a queue.
+ * Requests for the same scenario, that is the same grid, wind, seed and ignitions, are batched while
+ * they wait: the realizations are run once, to the longest number of steps asked for, and every
+ * request gets its results at its own step count. The realizations of a batch are spread over all the
+ * workers and streamed back as they finish, followed by the burned mask and arrival times.
+ */
+
+typedef struct ScenarioServerOptions {
+    const char* socket_path;
+    const char* const* grid_paths; // grid i of the requests is grid_paths[i]
+    size_t num_grids;
+    size_t num_workers; // 0 for one per CPU
+} ScenarioServerOptions;
+
+/// Serves until `*stop` is set, e.g. from a signal handler.
+/// Returns false if the grids couldn't be loaded or the socket couldn't be opened.
+bool runScenarioServer(const ScenarioServerOptions* options, volatile sig_atomic_t* stop);
@@ -0,0 +1,106 @@
+#include "simulation.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "direct_spread.h"
+#include "spotting_spread.h"
+#include "wind_field.h"
+#include <math.h>
+
+void stepAutomaton(CellularAutomaton* automaton) {
+    // Rebuilds the spread weights only when a new wind frame starts
+    if (automaton->wind)
+        updateWindField(automaton->wind, automaton->step);
+
+    // Spread fire
+    CellularAutomaton new = directSpread(automaton);
+    destroyAutomaton(automaton);
+    *automaton = new;
+
+    // Spread fire via spotting
+    new = spottingSpread(automaton);
+    destroyAutomaton(automaton);
+    *automaton = new;
+
+    // Burn cells based on heal / fuel left
+    new = burnoutCells(automaton);
+    destroyAutomaton(automaton);
+    *automaton = new;
+}
+
+// A cell can only catch fire if it is unburnt and not soaked
+static bool isIgnitable(const CellularAutomaton* automaton, int row, int col) {
+    if (row < 0 || row >= (int)automaton->num_rows)
+        return false;
+    if (col < 0 || col >= (int)automaton->rows[row].count)
+        return false;
+
+    const Cell* cell = &automaton->rows[row].elements[col];
+    return cell->state == CELLSTATE_NORMAL && cell->moisture < 1.f;
+}
+
+/// Checks if the burning cell has a non-zero chance to ignite anything,
+/// either a direct neighbour or a cell in the reach of its firebrands.
+static bool canIgnite(const CellularAutomaton* automaton, size_t row, size_t col) {
+    const int r = (int)row;
+    const int c = (int)col;
+
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (isIgnitable(automaton, r + dy, c + dx))
+                return true;
+        }
+    }
+
+    // A soaked cell never throws a firebrand
+    if (automaton->rows[row].elements[col].moisture >= 1.f)
+        return false;
+
+    // Firebrands land somewhere between 70% and 130% of the mean distance
+    const BlockWind wind = windAt(automaton, row, col);
+    const float distance = spottingDistance(wind.speed);
+    const int min_distance = (int)roundf(distance * 0.7f);
+    const int max_distance = (int)roundf(distance * 1.3f);
+    for (int d = min_distance; d <= max_distance; d++) {
+        if (isIgnitable(automaton, r + d * wind.windY, c + d * wind.windX))
+            return true;
+    }
+
+    return false;
+}
+
+size_t skipIdleSteps(CellularAutomaton* automaton, size_t max_steps) {
+    const BurnoutWheel* wheel = automaton->burnout;
+    if (!wheel)
+        return 0;
+
+    // We can't skip past a change of wind, since that might let the fire spread again
+    if (automaton->wind) {
+        updateWindField(automaton->wind, automaton->step);
+        const size_t change = nextWindChange(automaton->wind, automaton->step);
+        if (change - automaton->step < max_steps)
+            max_steps = change - automaton->step;
+    }
+
+    // Nothing is burning, so nothing will ever happen again
+    if (wheel->num_scheduled == 0) {
+        automaton->step += max_steps;
+        return max_steps;
+    }
+
+    // Every scheduled cell is burning, if any of them can spread we have to simulate
+    for (size_t slot = 0; slot < BURNOUT_WHEEL_SLOTS; slot++) {
+        for (size_t index = wheel->heads[slot]; index != BURNOUT_WHEEL_EMPTY; index = wheel->next[index]) {
+            if (canIgnite(automaton, index / wheel->num_columns, index % wheel->num_columns))
+                return 0;
+        }
+    }
+
+    // Nothing changes until the next burnout, so we jump straight to it
+    const size_t due = nextBurnoutStep(wheel, automaton->step);
+    size_t skipped = due - automaton->step;
+    if (skipped > max_steps)
+        skipped = max_steps;
+
+    automaton->step += skipped;
+    return skipped;
+}
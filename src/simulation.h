@@ -0,0 +1,11 @@
+#pragma once
+#include "cell.h"
+
+/// Advances the automaton one time step: direct spread, spotting and then burnout
+void stepAutomaton(CellularAutomaton* automaton);
+
+/// Fast-forwards over steps where nothing can change, so at most `max_steps`.
+/// This is only possible when the automaton has a burnout wheel, since that is what knows
+/// which cells are burning and when the next of them burns out.
+/// @return Returns the number of steps skipped
+size_t skipIdleSteps(CellularAutomaton* automaton, size_t max_steps);
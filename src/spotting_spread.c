@@ -1,19 +1,69 @@
 #include "spotting_spread.h"
 #include "cell.h"
+#include "burnout_cell.h"
+#include "wind_field.h"
+#include "wind_variants.h"
+#include "random.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
 
-static bool throwsFirebrand(const CellularAutomaton* automaton, size_t row, size_t col);
-static float ignitionSpotting(float distance, const Cell* dst_cell);
+static bool throwsFirebrand(const CellularAutomaton* automaton, size_t row, size_t col, WindSpeed speed);
 
 
-/// Modifies the Cellular Automaton by spreading the fire via spotting
-CellularAutomaton spottingSpread(const CellularAutomaton* automaton) {
-    CellularAutomaton new_automaton = cloneAutomaton(automaton);
+/// Lets the burning cell at (row, col) try to throw a firebrand with the given wind.
+/// Inlined into every kernel, so the wind folds to constants in the specialized ones.
+[[gnu::always_inline]]
+static inline void throwFirebrand(const CellularAutomaton* automaton, CellularAutomaton* new_automaton,
+                                  size_t row, size_t col, BlockWind wind) {
+    if (!throwsFirebrand(automaton, row, col, wind.speed))
+        return;
+
+    // Try and throw firebrand here:
+    float temp_distance = spottingDistance(wind.speed);
+
+    // implementer turbulens
+    float sigma = temp_distance * 0.3f;
+    float stochastic_value = simulationRandom() - 0.5f; // -0.5 til 0.5
+    float total_distance = temp_distance + sigma * stochastic_value * 2.0f;
+
+    const int dst_col = (int)col + ((int)roundf(total_distance) * wind.windX);
+    const int dst_row = (int)row + ((int)roundf(total_distance) * wind.windY);
+
+    // outside the simulation space
+    if (dst_col < 0 || dst_col >= (int)automaton->rows[row].count)
+        return;
+
+    if (dst_row < 0 || dst_row >= (int)automaton->num_rows)
+        return;
+
+    const Cell dst_cell = automaton->rows[dst_row].elements[dst_col];
+    if (dst_cell.state != CELLSTATE_NORMAL) // NOTE: Added after submitting repport
+        return;
+
+    // chance to spread to cell (with decay)
+    const float p = ignitionSpotting(total_distance, &dst_cell);
+    // determine if succeeds
+    const float determinator = simulationRandom();
+    if (determinator >= p)
+        return;
+
+    // Another firebrand already landed here this step
+    Cell* out_cell = &new_automaton->rows[dst_row].elements[dst_col];
+    if (out_cell->state == CELLSTATE_ONFIRE)
+        return;
 
-    for (size_t row = 0; row < automaton->num_rows; row++ ) {
+    // We are spreading to a cell!
+    out_cell->state = CELLSTATE_ONFIRE;
+    if (new_automaton->burnout)
+        scheduleBurnout(new_automaton->burnout, new_automaton->step, (size_t)dst_row, (size_t)dst_col, out_cell->type);
+}
+
+// Throws the firebrands of the burning cells in rows [first_row, end_row), with the wind of their block
+static void spottingSpreadGenericRows(const CellularAutomaton* automaton, CellularAutomaton* new_automaton,
+                                      size_t first_row, size_t end_row) {
+    for (size_t row = first_row; row < end_row; row++ ) {
         CellArray cell_arr = automaton->rows[row];
 
         for (size_t col = 0; col < cell_arr.count; col++ ) {
@@ -21,68 +71,95 @@ CellularAutomaton spottingSpread(const CellularAutomaton* automaton) {
             if (cell.state != CELLSTATE_ONFIRE)
                 continue;
 
-            if (!throwsFirebrand(automaton, row, col))
-                continue;
+            // The wind of the block the cell is in, it is the same everywhere without a wind field
+            throwFirebrand(automaton, new_automaton, row, col, windAt(automaton, row, col));
+        }
+    }
+}
 
-            // Try and throw firebrand here:
-            float temp_distance = 0.0f;
-            switch (automaton->speed) {
-            case WIND_NONE:
-                temp_distance = 1.0f;
-                break;
-            case WIND_SLOW:
-                temp_distance = 4.0f;
-                break;
-            case WIND_MODERATE:
-                temp_distance = 7.0f;
-                break;
-            case WIND_FAST:
-                temp_distance = 12.0f;
-                break;
-            case WIND_EXTREME:
-                temp_distance = 16.0f;
-                break;
-            default:
-                assert(false && "Invalid windspeed encountered");
-            }
-
-            // implementer turbulens
-            float sigma = temp_distance * 0.3f;
-            float stochastic_value = ((float)rand() / (float)RAND_MAX) - 0.5f; // -0.5 til 0.5
-            float total_distance = temp_distance + sigma * stochastic_value * 2.0f;
-
-            const int dst_col = (int)col + ((int)roundf(total_distance) * automaton->windX);
-            const int dst_row = (int)row + ((int)roundf(total_distance) * automaton->windY);
-
-            // outside the simulation space
-            if (dst_col < 0 || dst_col >= (int)cell_arr.count)
-                continue;
+/// Modifies the Cellular Automaton by spreading the fire via spotting,
+/// works for any wind, including a wind field
+CellularAutomaton spottingSpreadGeneric(const CellularAutomaton* automaton) {
+    CellularAutomaton new_automaton = cloneAutomaton(automaton);
+    spottingSpreadGenericRows(automaton, &new_automaton, 0, automaton->num_rows);
+    return new_automaton;
+}
 
-            if (dst_row < 0 || dst_row >= (int)automaton->num_rows)
+// Specialized kernels for uniform wind, the distance, turbulence and direction are constants in each
+[[gnu::always_inline]]
+static inline void spottingSpreadKernel(const CellularAutomaton* automaton, CellularAutomaton* new_automaton,
+                                        size_t first_row, size_t end_row, int windX, int windY, WindSpeed speed) {
+    const BlockWind wind = {
+        .windX = windX,
+        .windY = windY,
+        .speed = speed,
+    };
+
+    for (size_t row = first_row; row < end_row; row++) {
+        const CellArray cell_arr = automaton->rows[row];
+        for (size_t col = 0; col < cell_arr.count; col++) {
+            if (cell_arr.elements[col].state != CELLSTATE_ONFIRE)
                 continue;
 
-            const Cell dst_cell = automaton->rows[dst_row].elements[dst_col];
-            if (dst_cell.state != CELLSTATE_NORMAL) // NOTE: Added after submitting repport
-                continue;
+            throwFirebrand(automaton, new_automaton, row, col, wind);
+        }
+    }
+}
 
-            // chance to spread to cell (with decay)
-            const float p = ignitionSpotting(total_distance, &dst_cell);
-            // determine if succeeds
-            const float determinator = (float)rand() / (float)RAND_MAX;
-            if (determinator >= p)
-                continue;
+typedef void (*SpottingSpreadKernel)(const CellularAutomaton* automaton, CellularAutomaton* new_automaton,
+                                     size_t first_row, size_t end_row);
 
-            // We are spreading to a cell!
-            new_automaton.rows[dst_row].elements[dst_col].state = CELLSTATE_ONFIRE;
-        }
+#define DEFINE_SPOTTING_KERNEL(name, windX, windY, speed) \
+    static void spottingSpread_##name##_##speed(const CellularAutomaton* automaton, CellularAutomaton* new_automaton, \
+                                                size_t first_row, size_t end_row) { \
+        spottingSpreadKernel(automaton, new_automaton, first_row, end_row, windX, windY, (WindSpeed)speed); \
     }
+FOR_EACH_WIND_VARIANT(DEFINE_SPOTTING_KERNEL)
+#undef DEFINE_SPOTTING_KERNEL
+
+#define SPOTTING_KERNEL_ENTRY(name, windX, windY, speed) [windY + 1][windX + 1][speed] = spottingSpread_##name##_##speed,
+static const SpottingSpreadKernel spotting_kernels[3][3][WIND_LAST] = {
+    FOR_EACH_WIND_VARIANT(SPOTTING_KERNEL_ENTRY)
+};
+#undef SPOTTING_KERNEL_ENTRY
+
+/// Modifies the Cellular Automaton by spreading the fire via spotting
+CellularAutomaton spottingSpread(const CellularAutomaton* automaton) {
+    return spottingSpreadRows(automaton, 0, automaton->num_rows);
+}
 
+CellularAutomaton spottingSpreadRows(const CellularAutomaton* automaton, size_t first_row, size_t end_row) {
+    CellularAutomaton new_automaton = cloneAutomaton(automaton);
+
+    // The wind differs between blocks, only the generic path handles that
+    if (automaton->wind)
+        spottingSpreadGenericRows(automaton, &new_automaton, first_row, end_row);
+    else
+        spotting_kernels[automaton->windY + 1][automaton->windX + 1][automaton->speed](automaton, &new_automaton, first_row, end_row);
     return new_automaton;
 }
 
 
+float spottingDistance(WindSpeed speed) {
+    switch (speed) {
+    case WIND_NONE:
+        return 1.0f;
+    case WIND_SLOW:
+        return 4.0f;
+    case WIND_MODERATE:
+        return 7.0f;
+    case WIND_FAST:
+        return 12.0f;
+    case WIND_EXTREME:
+        return 16.0f;
+    default:
+        assert(false && "Invalid windspeed encountered");
+        return 0.0f;
+    }
+}
+
 // chance to spread to cell with cell decay
-static float ignitionSpotting(float total_distance, const Cell* dst_cell) {
+float ignitionSpotting(float total_distance, const Cell* dst_cell) {
     const float p0 = 0.5f;
     const float k  = 0.1f;
 
@@ -96,7 +173,7 @@ static float ignitionSpotting(float total_distance, const Cell* dst_cell) {
 }
 
 
-static bool throwsFirebrand(const CellularAutomaton* automaton, size_t row, size_t col) {
+float firebrandChance(const CellularAutomaton* automaton, size_t row, size_t col, WindSpeed speed) {
     const Cell cell = automaton->rows[row].elements[col];
 
     // Count number of burning neighbors
@@ -116,16 +193,24 @@ static bool throwsFirebrand(const CellularAutomaton* automaton, size_t row, size
         }
     }
 
+    return firebrandChanceFromCount(burning_neighbors, speed, cell.moisture);
+}
+
+float firebrandChanceFromCount(unsigned int burning_neighbors, WindSpeed speed, float moisture) {
     const float base_prop = .001f;
 
     const float neighbor_factor = (float)burning_neighbors * 0.2f;
-    const float wind_factor = (float)automaton->speed + 1.f;
-    const float moisture_factor = 1.f - cell.moisture; // Linear
+    const float wind_factor = (float)speed + 1.f;
+    const float moisture_factor = 1.f - moisture; // Linear
 
     // Chance that it throws a firebrand
-    const float p = base_prop * neighbor_factor * wind_factor * moisture_factor;
+    return base_prop * neighbor_factor * wind_factor * moisture_factor;
+}
+
+static bool throwsFirebrand(const CellularAutomaton* automaton, size_t row, size_t col, WindSpeed speed) {
+    const float p = firebrandChance(automaton, row, col, speed);
 
     // Evaluate said chance with random number from 0.f to 1.f
-    const float determinator = (float)rand() / (float)RAND_MAX;
+    const float determinator = simulationRandom();
     return determinator < p;
 }
@@ -1,5 +1,23 @@
 #pragma once
 #include "cell.h"
 
-/// Modifies the Cellular Automaton by spreading the fire via spotting
+/// Modifies the Cellular Automaton by spreading the fire via spotting.
+/// Uniform wind is dispatched to a kernel specialized for its direction and speed.
 CellularAutomaton spottingSpread(const CellularAutomaton* automaton);
+/// Spotting from the burning cells of rows [first_row, end_row) only, the firebrands can land anywhere.
+/// Used when the automaton holds rows that some other process throws the firebrands of.
+CellularAutomaton spottingSpreadRows(const CellularAutomaton* automaton, size_t first_row, size_t end_row);
+/// The unspecialized version of `spottingSpread`, which handles any wind
+CellularAutomaton spottingSpreadGeneric(const CellularAutomaton* automaton);
+
+/// Mean distance in cells a firebrand travels with the given wind speed.
+/// The turbulence spreads the actual distance by up to 30% in either direction.
+float spottingDistance(WindSpeed speed);
+
+/// Chance that the burning cell at (row, col) throws a firebrand this step
+float firebrandChance(const CellularAutomaton* automaton, size_t row, size_t col, WindSpeed speed);
+/// The same chance, for engines that count the burning neighbours in their own storage
+float firebrandChanceFromCount(unsigned int burning_neighbors, WindSpeed speed, float moisture);
+
+/// Chance that a firebrand which flew `distance` cells ignites the cell it lands on
+float ignitionSpotting(float distance, const Cell* dst_cell);
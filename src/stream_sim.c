@@ -0,0 +1,385 @@
+#define _GNU_SOURCE // sync_file_range
+#include "stream_sim.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "cellbin.h"
+#include "direct_spread.h"
+#include "random.h"
+#include "spotting_spread.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Marks a cell a firebrand landed in this step. It still counts as unburnt until its row burns.
+#define STREAM_SPOTTED ((uint8_t)'S')
+
+typedef struct MappedGrid {
+    int fd;
+    uint8_t* base; // the whole file, header included
+    size_t bytes;
+    PackedCell* cells;
+} MappedGrid;
+
+typedef struct StreamPass {
+    const MappedGrid* src;
+    MappedGrid* dst;
+    size_t width;
+    size_t height;
+    int windX;
+    int windY;
+    WindSpeed speed;
+    float spread_weights[8];
+    size_t lag; // rows between the phases
+    size_t band_rows;
+    size_t page_size;
+    Rng* rng;
+    StreamStats stats;
+} StreamPass;
+
+static bool mapGrid(const char* path, bool writable, MappedGrid* grid) {
+    grid->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (grid->fd < 0) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(grid->fd, &st) != 0 || (size_t)st.st_size < sizeof(CellbinHeader)) {
+        fprintf(stderr, "ERROR: \"%s\" is not a .cellbin file\n", path);
+        close(grid->fd);
+        return false;
+    }
+
+    grid->bytes = (size_t)st.st_size;
+    grid->base = mmap(nullptr, grid->bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, grid->fd, 0);
+    if (grid->base == MAP_FAILED) {
+        fprintf(stderr, "ERROR: failed to map \"%s\"\n", path);
+        close(grid->fd);
+        return false;
+    }
+    grid->cells = (PackedCell*)(grid->base + sizeof(CellbinHeader));
+
+    // The kernel reads ahead of the pipeline by itself, it is told about each band as well
+    madvise(grid->base, grid->bytes, MADV_SEQUENTIAL);
+    return true;
+}
+
+static void unmapGrid(MappedGrid* grid) {
+    munmap(grid->base, grid->bytes);
+    close(grid->fd);
+}
+
+/// Byte range of the rows [first, end) in the file
+static void rowRange(const StreamPass* pass, size_t first, size_t end, size_t* offset, size_t* length) {
+    const size_t row_bytes = pass->width * sizeof(PackedCell);
+    *offset = sizeof(CellbinHeader) + first * row_bytes;
+    *length = (end - first) * row_bytes;
+}
+
+static void readAhead(const StreamPass* pass, const MappedGrid* grid, size_t first, size_t end) {
+    if (end > pass->height)
+        end = pass->height;
+    if (first >= end)
+        return;
+
+    size_t offset, length;
+    rowRange(pass, first, end, &offset, &length);
+    const size_t start = offset & ~(pass->page_size - 1);
+    madvise(grid->base + start, offset + length - start, MADV_WILLNEED);
+}
+
+/// Starts writing the rows back and drops them from memory.
+/// Only whole pages are dropped, the rows at the edges may share one with rows still in use.
+static void release(const StreamPass* pass, const MappedGrid* grid, size_t first, size_t end, bool dirty) {
+    size_t offset, length;
+    rowRange(pass, first, end, &offset, &length);
+    const size_t start = (offset + pass->page_size - 1) & ~(pass->page_size - 1);
+    const size_t stop = (offset + length) & ~(pass->page_size - 1);
+    if (stop <= start)
+        return;
+
+    if (dirty)
+        sync_file_range(grid->fd, (off_t)start, (off_t)(stop - start), SYNC_FILE_RANGE_WRITE);
+    madvise(grid->base + start, stop - start, MADV_DONTNEED);
+    // Clean pages leave the page cache right away, the ones being written back after they are
+    posix_fadvise(grid->fd, (off_t)start, (off_t)(stop - start), POSIX_FADV_DONTNEED);
+}
+
+static inline PackedCell* cellAt(const MappedGrid* grid, const StreamPass* pass, size_t row, size_t col) {
+    return &grid->cells[row * pass->width + col];
+}
+
+/// Direct spread into row `row` of the destination, pulled from the burning neighbours in the source,
+/// like the parallel engine does
+static void directRow(StreamPass* pass, size_t row) {
+    for (size_t col = 0; col < pass->width; col++) {
+        const PackedCell packed = *cellAt(pass->src, pass, row, col);
+        PackedCell* out = cellAt(pass->dst, pass, row, col);
+        *out = packed;
+        if (packed.state != CELLSTATE_NORMAL)
+            continue;
+
+        const Cell dst = unpackCell(packed);
+        for (int dy = -1; dy <= 1 && out->state == CELLSTATE_NORMAL; dy++) {
+            const ptrdiff_t src_row = (ptrdiff_t)row + dy;
+            if (src_row < 0 || src_row >= (ptrdiff_t)pass->height)
+                continue;
+
+            for (int dx = -1; dx <= 1; dx++) {
+                const ptrdiff_t src_col = (ptrdiff_t)col + dx;
+                if ((dx == 0 && dy == 0) || src_col < 0 || src_col >= (ptrdiff_t)pass->width)
+                    continue;
+
+                const PackedCell src_packed = *cellAt(pass->src, pass, (size_t)src_row, (size_t)src_col);
+                if (src_packed.state != CELLSTATE_ONFIRE)
+                    continue;
+
+                const Cell src = unpackCell(src_packed);
+                const float a_w = pass->spread_weights[neighbourIndex(-dx, -dy)];
+                if (rngFloat(pass->rng) >= chanceToSpread(&src, &dst, a_w, 1.0f))
+                    continue;
+
+                out->state = CELLSTATE_ONFIRE;
+                break;
+            }
+        }
+    }
+}
+
+/// The neighbour count of `firebrandChance`, on the packed cells
+static unsigned burningNeighbours(const StreamPass* pass, size_t row, size_t col) {
+    // It never counts anything in the first row or column
+    if (row == 0 || col == 0)
+        return 0;
+
+    const unsigned columns = col + 1 < pass->width ? 3 : 2;
+    unsigned count = 0;
+    for (size_t neighbour_row = row - 1; neighbour_row <= row + 1 && neighbour_row < pass->height; neighbour_row++)
+        count += cellAt(pass->dst, pass, neighbour_row, col)->state == CELLSTATE_ONFIRE ? columns : 0;
+    return count;
+}
+
+/// Firebrands from the burning cells of `row`, after the direct spread of this step
+static void spottingRow(StreamPass* pass, size_t row) {
+    const float temp_distance = spottingDistance(pass->speed);
+    const float sigma = temp_distance * 0.3f;
+
+    for (size_t col = 0; col < pass->width; col++) {
+        const PackedCell packed = *cellAt(pass->dst, pass, row, col);
+        if (packed.state != CELLSTATE_ONFIRE)
+            continue;
+
+        const float chance = firebrandChanceFromCount(burningNeighbours(pass, row, col), pass->speed,
+                                                      (float)packed.moisture / 100.f);
+        if (rngFloat(pass->rng) >= chance)
+            continue;
+
+        const float stochastic_value = rngFloat(pass->rng) - 0.5f;
+        const float total_distance = temp_distance + sigma * stochastic_value * 2.0f;
+
+        const ptrdiff_t dst_col = (ptrdiff_t)col + (ptrdiff_t)roundf(total_distance) * pass->windX;
+        const ptrdiff_t dst_row = (ptrdiff_t)row + (ptrdiff_t)roundf(total_distance) * pass->windY;
+        if (dst_col < 0 || dst_col >= (ptrdiff_t)pass->width)
+            continue;
+        if (dst_row < 0 || dst_row >= (ptrdiff_t)pass->height)
+            continue;
+
+        PackedCell* dst = cellAt(pass->dst, pass, (size_t)dst_row, (size_t)dst_col);
+        if (dst->state != CELLSTATE_NORMAL && dst->state != STREAM_SPOTTED)
+            continue;
+
+        const Cell dst_cell = unpackCell(*dst);
+        if (rngFloat(pass->rng) >= ignitionSpotting(total_distance, &dst_cell))
+            continue;
+
+        dst->state = STREAM_SPOTTED;
+    }
+}
+
+/// Lands the firebrands of `row` and burns it, after which the row is final for this step
+static void burnoutRow(StreamPass* pass, size_t row) {
+    for (size_t col = 0; col < pass->width; col++) {
+        PackedCell* packed = cellAt(pass->dst, pass, row, col);
+        if (packed->state == STREAM_SPOTTED)
+            packed->state = CELLSTATE_ONFIRE;
+
+        if (packed->state == CELLSTATE_ONFIRE) {
+            Cell cell = unpackCell(*packed);
+            burnCell(&cell);
+            *packed = packCell(&cell);
+        }
+
+        pass->stats.burning += packed->state == CELLSTATE_ONFIRE;
+        pass->stats.burnt += packed->state == CELLSTATE_BURNT;
+    }
+}
+
+static void runPass(StreamPass* pass) {
+    const size_t lag = pass->lag;
+    const size_t band = pass->band_rows;
+    pass->stats = (StreamStats) {
+        .cells = pass->width * pass->height,
+    };
+
+    readAhead(pass, pass->src, 0, band);
+    for (size_t row = 0; row < pass->height + 2 * lag; row++) {
+        // The next band is read while this one is worked on
+        if (row % band == 0) {
+            readAhead(pass, pass->src, row + band, row + 2 * band);
+            readAhead(pass, pass->dst, row + band, row + 2 * band);
+        }
+
+        if (row < pass->height)
+            directRow(pass, row);
+        if (row >= lag && row - lag < pass->height)
+            spottingRow(pass, row - lag);
+
+        if (row < 2 * lag)
+            continue;
+        const size_t burnt_row = row - 2 * lag;
+        if (burnt_row >= pass->height)
+            continue;
+        burnoutRow(pass, burnt_row);
+
+        // Nothing looks at the rows of a band behind the burnout any more
+        if ((burnt_row + 1) % band == 0 || burnt_row + 1 == pass->height) {
+            const size_t first = burnt_row / band * band;
+            release(pass, pass->src, first, burnt_row + 1, false);
+            release(pass, pass->dst, first, burnt_row + 1, true);
+        }
+    }
+}
+
+static bool copyFile(const char* from, const char* to) {
+    FILE* in = fopen(from, "rb");
+    if (!in) {
+        fprintf(stderr, "Failed to open file: %s\n", from);
+        return false;
+    }
+    FILE* out = fopen(to, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open file: %s\n", to);
+        fclose(in);
+        return false;
+    }
+
+    static char buffer[1 << 20];
+    bool ok = true;
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, read, out) != read) {
+            ok = false;
+            break;
+        }
+    }
+    ok = ok && !ferror(in);
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    if (!ok)
+        fprintf(stderr, "ERROR: failed to copy \"%s\" to \"%s\"\n", from, to);
+    return ok;
+}
+
+bool streamSimulate(const char* in_path, const char* out_path, size_t steps,
+                    const StreamOptions* options, StreamStats* stats) {
+    const size_t swap_len = strlen(out_path) + sizeof(".swap");
+    char* swap_path = malloc(swap_len);
+    if (!swap_path) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(swap_path, swap_len, "%s.swap", out_path);
+
+    // The steps alternate between the two files, so start in the one that makes the last step end in `out_path`
+    const char* paths[2] = {out_path, swap_path};
+    // The other file only needs the header and the size, the steps write all of its cells
+    bool ok = copyFile(in_path, paths[0]) && copyFile(in_path, paths[1]);
+    if (!ok)
+        goto cleanup;
+
+    MappedGrid grids[2];
+    if (!mapGrid(paths[0], true, &grids[0])) {
+        ok = false;
+        goto cleanup;
+    }
+    if (!mapGrid(paths[1], true, &grids[1])) {
+        unmapGrid(&grids[0]);
+        ok = false;
+        goto cleanup;
+    }
+
+    CellbinHeader header;
+    memcpy(&header, grids[0].base, sizeof(header));
+    if (!validateCellbinHeader(&header, grids[0].bytes, in_path)) {
+        ok = false;
+        goto unmap;
+    }
+
+    Rng rng = seedRng(options->seed);
+    StreamPass pass = {
+        .width = header.width,
+        .height = header.height,
+        .windX = header.windX,
+        .windY = header.windY,
+        .speed = (WindSpeed)header.speed,
+        .page_size = (size_t)sysconf(_SC_PAGESIZE),
+        .rng = &rng,
+    };
+
+    // The farthest a firebrand flies, with all the turbulence. Rows only need to wait for it when the wind has a vertical part,
+    // but spotting always counts the burning cells of the next row and burnout may not run before that.
+    const size_t reach = (size_t)roundf(spottingDistance(pass.speed) * 1.3f);
+    pass.lag = pass.windY != 0 ? reach : 1;
+
+    const size_t row_bytes = pass.width * sizeof(PackedCell);
+    pass.band_rows = options->band_rows;
+    if (pass.band_rows == 0)
+        pass.band_rows = row_bytes ? (16u << 20) / row_bytes : 1;
+    if (pass.band_rows == 0)
+        pass.band_rows = 1;
+
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (dx != 0 || dy != 0)
+                pass.spread_weights[neighbourIndex(dx, dy)] = windFactor(pass.windX, pass.windY, pass.speed, dx, dy);
+        }
+    }
+
+    size_t current = steps & 1;
+    pass.stats = (StreamStats) { .cells = pass.width * pass.height };
+    for (size_t step = 0; step < steps; step++) {
+        pass.src = &grids[current];
+        pass.dst = &grids[current ^ 1];
+        runPass(&pass);
+        current ^= 1;
+    }
+
+    // Without any steps there was nothing to count on the way
+    if (steps == 0) {
+        for (size_t index = 0; index < pass.stats.cells; index++) {
+            pass.stats.burning += grids[0].cells[index].state == CELLSTATE_ONFIRE;
+            pass.stats.burnt += grids[0].cells[index].state == CELLSTATE_BURNT;
+        }
+    }
+    if (stats)
+        *stats = pass.stats;
+
+    if (msync(grids[0].base, grids[0].bytes, MS_SYNC) != 0) {
+        fprintf(stderr, "ERROR: failed to write file \"%s\"\n", out_path);
+        ok = false;
+    }
+
+unmap:
+    unmapGrid(&grids[0]);
+    unmapGrid(&grids[1]);
+
+cleanup:
+    unlink(swap_path);
+    free(swap_path);
+    return ok;
+}
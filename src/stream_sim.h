@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Out-of-core simulation of .cellbin grids that don't fit in memory.
+ *
+ * Each step streams the grid through once, from one memory mapped file into another. The three
+ * phases of a step run as a pipeline over the rows: direct spread at row r, spotting a firebrand
+ * reach behind it and burnout another reach behind that, so only a window of a few bands has to be
+ * resident. The bands ahead are read ahead and the finished bands are written back and dropped.
+ *
+ * Only the wind of the header is used, there is no terrain or wind field in this mode.
+ * Like the parallel engine it draws from its own random generator, so it matches the in-memory
+ * engine in distribution, not cell for cell.
+ */
+
+typedef struct StreamOptions {
+    size_t band_rows; // rows read ahead and written back at once, 0 picks about 16 MiB worth
+    uint64_t seed;
+} StreamOptions;
+
+typedef struct StreamStats {
+    size_t burning;
+    size_t burnt;
+    size_t cells;
+} StreamStats;
+
+/// Runs `steps` steps of the grid in `in_path` and writes the result to `out_path`.
+/// `out_path` with ".swap" appended is used as the second file while running and removed after.
+/// The counts of the final state go in `stats` if it isn't null.
+bool streamSimulate(const char* in_path, const char* out_path, size_t steps,
+                    const StreamOptions* options, StreamStats* stats);
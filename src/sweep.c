@@ -0,0 +1,386 @@
+#define _GNU_SOURCE
+#include "sweep.h"
+#include "cell.h"
+#include "random.h"
+#include "wildfire.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct Direction {
+    const char* name;
+    int windX;
+    int windY;
+} Direction;
+
+static const Direction directions[] = {
+    {"nw", -1, -1}, {"n", 0, -1}, {"ne", 1, -1},
+    {"w", -1, 0},   {"calm", 0, 0}, {"e", 1, 0},
+    {"sw", -1, 1},  {"s", 0, 1},  {"se", 1, 1},
+};
+
+static const char* directionName(int windX, int windY) {
+    return directions[(windY + 1) * 3 + windX + 1].name;
+}
+
+/// Runs left in one worker's range, the owner takes from the front and thieves from the back
+typedef struct RunRange {
+    pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+} RunRange;
+
+/// What a worker added up per scenario, merged once everyone is done
+typedef struct ScenarioTally {
+    double sum;
+    double sum_squared;
+    size_t min;
+    size_t max;
+    size_t count;
+} ScenarioTally;
+
+typedef struct SweepWorker {
+    struct Sweep* sweep;
+    pthread_t thread;
+    size_t index;
+    RunRange range;
+    ScenarioTally* tallies;
+    WildfireContext* context;
+} SweepWorker;
+
+typedef struct Sweep {
+    const SweepSpec* spec;
+    SweepWorker* workers;
+    size_t num_workers;
+} Sweep;
+
+static SweepSpec makeSweepSpec(const WindSpeed* speeds, size_t num_speeds, const Direction* const* directions_used,
+                               size_t num_directions, const SweepSpec* settings) {
+    SweepSpec spec = *settings;
+    spec.num_scenarios = num_speeds * num_directions;
+    spec.scenarios = malloc((spec.num_scenarios ? spec.num_scenarios : 1) * sizeof(SweepScenario));
+    if (!spec.scenarios) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t speed = 0; speed < num_speeds; speed++) {
+        for (size_t direction = 0; direction < num_directions; direction++) {
+            spec.scenarios[speed * num_directions + direction] = (SweepScenario) {
+                .windX = directions_used[direction]->windX,
+                .windY = directions_used[direction]->windY,
+                .speed = speeds[speed],
+            };
+        }
+    }
+    return spec;
+}
+
+SweepSpec defaultSweepSpec(size_t steps, size_t realizations, uint64_t seed) {
+    const WindSpeed speeds[] = {WIND_NONE, WIND_SLOW, WIND_MODERATE, WIND_FAST, WIND_EXTREME};
+    const Direction* compass[8];
+    size_t num_directions = 0;
+    for (size_t direction = 0; direction < sizeof(directions) / sizeof(directions[0]); direction++) {
+        if (directions[direction].windX != 0 || directions[direction].windY != 0)
+            compass[num_directions++] = &directions[direction];
+    }
+
+    const SweepSpec settings = {
+        .steps = steps,
+        .realizations = realizations,
+        .seed = seed,
+    };
+    return makeSweepSpec(speeds, 5, compass, num_directions, &settings);
+}
+
+bool readSweepSpec(const char* path, SweepSpec* spec) {
+    FILE* fd = fopen(path, "r");
+    if (!fd) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return false;
+    }
+
+    SweepSpec settings = {
+        .steps = 30,
+        .realizations = 100,
+        .seed = 1,
+    };
+
+    WindSpeed speeds[WIND_LAST] = {WIND_NONE, WIND_SLOW, WIND_MODERATE, WIND_FAST, WIND_EXTREME};
+    size_t num_speeds = WIND_LAST;
+    const Direction* directions_used[9];
+    size_t num_directions = 0;
+    for (size_t direction = 0; direction < 9; direction++) {
+        if (directions[direction].windX != 0 || directions[direction].windY != 0)
+            directions_used[num_directions++] = &directions[direction];
+    }
+
+    char line[1024];
+    size_t line_num = 0;
+    while (fgets(line, sizeof(line), fd)) {
+        line_num++;
+        char* save = nullptr;
+        const char* key = strtok_r(line, ",\r\n", &save);
+        if (!key)
+            continue;
+
+        const bool is_speeds = strcmp(key, "speeds") == 0;
+        const bool is_directions = strcmp(key, "directions") == 0;
+        if (is_speeds)
+            num_speeds = 0;
+        if (is_directions)
+            num_directions = 0;
+
+        for (const char* value = strtok_r(nullptr, ",\r\n", &save); value; value = strtok_r(nullptr, ",\r\n", &save)) {
+            char* end = nullptr;
+            const unsigned long long number = strtoull(value, &end, 10);
+            const bool is_number = end != value && *end == '\0';
+
+            if (is_directions) {
+                size_t direction = 0;
+                while (direction < 9 && strcmp(directions[direction].name, value) != 0)
+                    direction++;
+                if (direction == 9 || num_directions == 9)
+                    goto err_value;
+                directions_used[num_directions++] = &directions[direction];
+            } else if (!is_number) {
+                goto err_value;
+            } else if (is_speeds) {
+                if (number >= WIND_LAST || num_speeds == WIND_LAST)
+                    goto err_value;
+                speeds[num_speeds++] = (WindSpeed)number;
+            } else if (strcmp(key, "steps") == 0) {
+                settings.steps = (size_t)number;
+            } else if (strcmp(key, "realizations") == 0) {
+                settings.realizations = (size_t)number;
+            } else if (strcmp(key, "seed") == 0) {
+                settings.seed = number;
+            } else {
+                fprintf(stderr, "ERROR: unknown key \"%s\" on line %zu of \"%s\"\n", key, line_num, path);
+                fclose(fd);
+                return false;
+            }
+            continue;
+
+        err_value:
+            fprintf(stderr, "ERROR: invalid value \"%s\" for \"%s\" on line %zu of \"%s\"\n", value, key, line_num, path);
+            fclose(fd);
+            return false;
+        }
+    }
+    fclose(fd);
+
+    if (num_speeds == 0 || num_directions == 0 || settings.realizations == 0) {
+        fprintf(stderr, "ERROR: the sweep in \"%s\" has no runs\n", path);
+        return false;
+    }
+
+    *spec = makeSweepSpec(speeds, num_speeds, directions_used, num_directions, &settings);
+    return true;
+}
+
+void destroySweepSpec(SweepSpec* spec) {
+    free(spec->scenarios);
+    spec->scenarios = nullptr;
+    spec->num_scenarios = 0;
+}
+
+/// Takes the next run of the worker's own range
+static bool takeRun(SweepWorker* worker, size_t* run) {
+    pthread_mutex_lock(&worker->range.lock);
+    const bool found = worker->range.begin < worker->range.end;
+    if (found)
+        *run = worker->range.begin++;
+    pthread_mutex_unlock(&worker->range.lock);
+    return found;
+}
+
+/// Moves the back half of the fullest other range to this worker, returns false when nothing is left
+static bool stealRuns(SweepWorker* thief) {
+    const Sweep* sweep = thief->sweep;
+
+    for (;;) {
+        // The ranges can change after they are looked at, so the victim is checked again when it is locked
+        SweepWorker* victim = nullptr;
+        size_t most = 0;
+        for (size_t index = 0; index < sweep->num_workers; index++) {
+            SweepWorker* worker = &sweep->workers[index];
+            if (worker == thief)
+                continue;
+
+            pthread_mutex_lock(&worker->range.lock);
+            const size_t left = worker->range.end - worker->range.begin;
+            pthread_mutex_unlock(&worker->range.lock);
+            if (left > most) {
+                victim = worker;
+                most = left;
+            }
+        }
+        if (!victim)
+            return false;
+
+        pthread_mutex_lock(&victim->range.lock);
+        const size_t left = victim->range.end - victim->range.begin;
+        if (left == 0) {
+            pthread_mutex_unlock(&victim->range.lock);
+            continue;
+        }
+
+        const size_t stolen = left > 1 ? left / 2 : 1;
+        const size_t end = victim->range.end;
+        victim->range.end -= stolen;
+        pthread_mutex_unlock(&victim->range.lock);
+
+        pthread_mutex_lock(&thief->range.lock);
+        thief->range.begin = end - stolen;
+        thief->range.end = end;
+        pthread_mutex_unlock(&thief->range.lock);
+        return true;
+    }
+}
+
+static size_t countBurnt(const WildfireView* view) {
+    const size_t num_cells = view->num_rows * view->num_columns;
+    size_t burnt = 0;
+    for (size_t cell = 0; cell < num_cells; cell++)
+        burnt += view->cells[cell].state != CELLSTATE_NORMAL;
+    return burnt;
+}
+
+static void runSweepRun(SweepWorker* worker, size_t run) {
+    const SweepSpec* spec = worker->sweep->spec;
+    const size_t scenario_index = run / spec->realizations;
+    const size_t realization = run % spec->realizations;
+    const SweepScenario* scenario = &spec->scenarios[scenario_index];
+
+    // The same realization gets the same random numbers in every scenario
+    seedSimulation(spec->seed * 0x100000001B3ull + realization);
+    wildfireReset(worker->context);
+    wildfireSetWind(worker->context, scenario->windX, scenario->windY, scenario->speed);
+    wildfireStep(worker->context, spec->steps);
+
+    const WildfireView view = wildfireState(worker->context);
+    const size_t burnt = countBurnt(&view);
+
+    ScenarioTally* tally = &worker->tallies[scenario_index];
+    tally->sum += (double)burnt;
+    tally->sum_squared += (double)burnt * (double)burnt;
+    tally->min = tally->count == 0 || burnt < tally->min ? burnt : tally->min;
+    tally->max = burnt > tally->max ? burnt : tally->max;
+    tally->count++;
+}
+
+static void* sweepWorkerMain(void* userdata) {
+    SweepWorker* worker = userdata;
+
+    for (;;) {
+        size_t run;
+        if (takeRun(worker, &run)) {
+            runSweepRun(worker, run);
+            continue;
+        }
+        if (!stealRuns(worker))
+            break;
+    }
+    return nullptr;
+}
+
+SweepSummary* runSweep(const WildfireContext* context, const SweepSpec* spec, size_t num_threads) {
+    if (num_threads == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t)online : 1;
+    }
+
+    const size_t num_runs = spec->num_scenarios * spec->realizations;
+    Sweep sweep = {
+        .spec = spec,
+        .workers = calloc(num_threads, sizeof(SweepWorker)),
+        .num_workers = num_threads,
+    };
+    SweepSummary* summaries = calloc(spec->num_scenarios ? spec->num_scenarios : 1, sizeof(SweepSummary));
+    if (!sweep.workers || !summaries) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t index = 0; index < num_threads; index++) {
+        SweepWorker* worker = &sweep.workers[index];
+        *worker = (SweepWorker) {
+            .sweep = &sweep,
+            .index = index,
+            .range = {
+                .begin = index * num_runs / num_threads,
+                .end = (index + 1) * num_runs / num_threads,
+            },
+            .tallies = calloc(spec->num_scenarios ? spec->num_scenarios : 1, sizeof(ScenarioTally)),
+            .context = wildfireClone(context),
+        };
+        pthread_mutex_init(&worker->range.lock, nullptr);
+        if (!worker->tallies || !worker->context) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    size_t started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&sweep.workers[started].thread, nullptr, sweepWorkerMain, &sweep.workers[started]) != 0) {
+            fprintf(stderr, "Failed to start worker thread %zu\n", started);
+            break;
+        }
+    }
+    // If some threads didn't start, the ones that did steal their runs
+    if (started == 0)
+        sweepWorkerMain(&sweep.workers[0]);
+    for (size_t index = 0; index < started; index++)
+        pthread_join(sweep.workers[index].thread, nullptr);
+
+    for (size_t scenario = 0; scenario < spec->num_scenarios; scenario++) {
+        ScenarioTally total = {0};
+        for (size_t index = 0; index < num_threads; index++) {
+            const ScenarioTally* tally = &sweep.workers[index].tallies[scenario];
+            if (tally->count == 0)
+                continue;
+            total.min = total.count == 0 || tally->min < total.min ? tally->min : total.min;
+            total.max = tally->max > total.max ? tally->max : total.max;
+            total.sum += tally->sum;
+            total.sum_squared += tally->sum_squared;
+            total.count += tally->count;
+        }
+
+        const double count = total.count ? (double)total.count : 1.0;
+        const double mean = total.sum / count;
+        const double variance = total.sum_squared / count - mean * mean;
+        summaries[scenario] = (SweepSummary) {
+            .mean_burnt = mean,
+            .stddev_burnt = variance > 0.0 ? sqrt(variance) : 0.0,
+            .min_burnt = total.min,
+            .max_burnt = total.max,
+        };
+    }
+
+    for (size_t index = 0; index < num_threads; index++) {
+        SweepWorker* worker = &sweep.workers[index];
+        pthread_mutex_destroy(&worker->range.lock);
+        free(worker->tallies);
+        wildfireDestroy(worker->context);
+    }
+    free(sweep.workers);
+    return summaries;
+}
+
+void printSweepSummary(const SweepSpec* spec, const SweepSummary* summaries, size_t num_cells, FILE* fd) {
+    fprintf(fd, "%zu scenarios x %zu realizations of %zu steps, burnt cells at the end\n",
+            spec->num_scenarios, spec->realizations, spec->steps);
+    fprintf(fd, "direction  speed       mean     stddev      min      max   %% of grid\n");
+    for (size_t scenario = 0; scenario < spec->num_scenarios; scenario++) {
+        const SweepScenario* wind = &spec->scenarios[scenario];
+        const SweepSummary* summary = &summaries[scenario];
+        fprintf(fd, "%-9s  %5d  %9.2f  %9.2f  %7zu  %7zu  %9.2f\n",
+                directionName(wind->windX, wind->windY), (int)wind->speed, summary->mean_burnt, summary->stddev_burnt,
+                summary->min_burnt, summary->max_burnt, 100.0 * summary->mean_burnt / (double)num_cells);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "cell.h"
+#include "wildfire.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Parameter sweep over uniform winds on one grid.
+ *
+ * Every scenario is a wind direction and speed, run `realizations` times. The scenarios x realizations
+ * are split over a pool of threads, each stepping its own clone of one context, so the terrain is in
+ * memory once. Every thread starts with a contiguous range of the runs and steals half of what is left
+ * of someone else's range when it runs out, so slow scenarios (fast wind, big fires) don't leave the
+ * rest of the threads idle.
+ */
+
+typedef struct SweepScenario {
+    int windX;
+    int windY;
+    WindSpeed speed;
+} SweepScenario;
+
+typedef struct SweepSpec {
+    SweepScenario* scenarios;
+    size_t num_scenarios;
+    size_t steps;
+    size_t realizations;
+    uint64_t seed;
+} SweepSpec;
+
+typedef struct SweepSummary {
+    double mean_burnt; // cells the fire reached, burnt or still burning at the end
+    double stddev_burnt;
+    size_t min_burnt;
+    size_t max_burnt;
+} SweepSummary;
+
+/// All 5 speeds in all 8 directions
+SweepSpec defaultSweepSpec(size_t steps, size_t realizations, uint64_t seed);
+
+/// Reads a sweep spec, lines of a key followed by its values, each followed by a ','.
+/// steps, realizations and seed take one number; speeds takes numbers from 0 to 4 and directions
+/// takes names from nw, n, ne, w, calm, e, sw, s and se. Every speed is run in every direction.
+/// Missing keys keep the values of the default spec.
+bool readSweepSpec(const char* path, SweepSpec* spec);
+void destroySweepSpec(SweepSpec* spec);
+
+/// Runs the sweep on `num_threads` threads, 0 for one per CPU.
+/// Returns a summary per scenario, in the order of the spec, free it with `free`.
+SweepSummary* runSweep(const WildfireContext* context, const SweepSpec* spec, size_t num_threads);
+
+void printSweepSummary(const SweepSpec* spec, const SweepSummary* summaries, size_t num_cells, FILE* fd);
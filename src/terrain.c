@@ -0,0 +1,157 @@
+#include "terrain.h"
+#include "arena.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Slope coefficient from source https://www.mdpi.com/2571-6255/3/3/26, per degree of slope
+static constexpr float slope_coefficient = 0.078f;
+static constexpr float degrees_per_radian = 57.2957795f;
+static constexpr float log2_e = 1.44269504f;
+static constexpr float half_pi = 1.57079633f;
+static constexpr float quarter_pi = 0.785398163f;
+
+/// atanf after Cephes: reduced to |x| <= tan(pi/8) and a polynomial there, within 2e-7 radians.
+/// Only arithmetic, unlike the library call, so loops over it vectorize. The reductions are chosen
+/// by multiplying with 0 or 1: gcc moves an operation only one side of a select needs into a branch,
+/// and can't turn it back into a select since floating point operations may trap.
+static inline float approxAtan(float x) {
+    const float magnitude = fabsf(x);
+
+    // atan(|x|) = pi/2 - atan(1/|x|) above 1
+    const float above_one = magnitude > 1.f ? 1.f : 0.f;
+    const float t = magnitude / (1.f + above_one * (magnitude * magnitude - 1.f));
+
+    // atan(t) = pi/4 + atan((t - 1) / (1 + t)) above tan(pi/8), where t * (1 + sqrt(2)) truncates to 1 or 2.
+    // Halved, rounding up, that is 1 there and 0 below, without a select gcc could fold t - k into.
+    const int32_t eighths = (int32_t)(t * 2.41421356f);
+    const float k = (float)((eighths + 1) >> 1);
+    const float reduced = (t - k) / (1.f + k * t);
+
+    const float z = reduced * reduced;
+    const float atan_t = k * quarter_pi + reduced
+        + (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * reduced;
+    return copysignf(above_one * half_pi + (1.f - 2.f * above_one) * atan_t, x);
+}
+
+/// 2^x after Cephes' exp2f: 2^n for the nearest integer n, built in the exponent bits, times a
+/// polynomial for the rest, within 2e-7 relative. Only for |x| < 126, the slopes stay within +-10.
+static inline float approxExp2(float x) {
+    const int32_t n = (int32_t)(x + copysignf(0.5f, x));
+    const float f = x - (float)n;
+    const float fraction = 1.f
+        + (((((1.535336188319500e-4f * f + 1.339887440266574e-3f) * f + 9.618437357674640e-3f) * f + 5.550332471162809e-2f) * f
+            + 2.402264791363012e-1f) * f + 6.931472028550421e-1f) * f;
+
+    const uint32_t bits = (uint32_t)(n + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return fraction * scale;
+}
+
+/// Fills in the slope factor towards one neighbour direction for a whole row.
+/// exp(slope_coefficient * degrees) is taken as a power of 2 of the radians, both approximated inline
+/// so the loop vectorizes at -O3. That is within 2e-6 of expf and atanf.
+static void computeSlopeRow(const float* restrict src_row, const float* restrict dst_row, float* restrict out,
+                            size_t num_columns, int dx, float distance) {
+    // Columns where the neighbour is inside the grid
+    const size_t first = dx < 0 ? 1u : 0u;
+    const size_t last = dx > 0 ? num_columns - 1 : num_columns;
+    const float inv_distance = 1.f / distance;
+    const float exp2_per_radian = slope_coefficient * degrees_per_radian * log2_e;
+
+    for (size_t col = 0; col < first; col++)
+        out[col] = 1.f;
+
+    for (size_t col = first; col < last; col++) {
+        // Uphill is positive, fire spreads faster uphill
+        const float rise = dst_row[(ptrdiff_t)col + dx] - src_row[col];
+        out[col] = approxExp2(exp2_per_radian * approxAtan(rise * inv_distance));
+    }
+
+    for (size_t col = last; col < num_columns; col++)
+        out[col] = 1.f;
+}
+
+Terrain* createTerrain(float* elevation, size_t num_rows, size_t num_columns, float cell_size) {
+    Terrain* terrain = malloc(sizeof(Terrain));
+    float* slope_factors = malloc(num_rows * num_columns * 8 * sizeof(float));
+    // One contiguous row of factors per direction, interleaved into the cache afterwards
+    float* scratch = malloc(num_columns * 8 * sizeof(float));
+    if (!terrain || !slope_factors || !scratch) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t row = 0; row < num_rows; row++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0)
+                    continue;
+
+                float* out = scratch + neighbourIndex(dx, dy) * num_columns;
+
+                // Neighbours outside the grid are never spread to, but we keep them neutral anyway
+                const ptrdiff_t dst_row = (ptrdiff_t)row + dy;
+                if (dst_row < 0 || dst_row >= (ptrdiff_t)num_rows) {
+                    for (size_t col = 0; col < num_columns; col++)
+                        out[col] = 1.f;
+                    continue;
+                }
+
+                const float distance = (dx != 0 && dy != 0) ? cell_size * sqrtf(2.f) : cell_size;
+                computeSlopeRow(elevation + row * num_columns,
+                                elevation + (size_t)dst_row * num_columns,
+                                out, num_columns, dx, distance);
+            }
+        }
+
+        float* row_factors = slope_factors + row * num_columns * 8;
+        for (size_t col = 0; col < num_columns; col++) {
+            for (size_t direction = 0; direction < 8; direction++)
+                row_factors[col * 8 + direction] = scratch[direction * num_columns + col];
+        }
+    }
+
+    free(scratch);
+
+    *terrain = (Terrain) {
+        .elevation = elevation,
+        .slope_factors = slope_factors,
+        .num_rows = num_rows,
+        .num_columns = num_columns,
+        .cell_size = cell_size,
+        .arena = nullptr,
+    };
+    return terrain;
+}
+
+void destroyTerrain(Terrain* terrain) {
+    if (!terrain)
+        return;
+
+    free(terrain->elevation);
+    if (!terrain->arena)
+        free(terrain->slope_factors);
+    free(terrain);
+}
+
+size_t terrainArenaBytes(const Terrain* terrain) {
+    if (!terrain)
+        return 0;
+    return terrain->num_rows * terrain->num_columns * 8 * sizeof(float) + ARENA_ALIGNMENT;
+}
+
+void moveTerrainIntoArena(Terrain* terrain, SimArena* arena) {
+    assert(terrain->arena == nullptr && "The terrain is already in an arena");
+
+    const size_t bytes = terrain->num_rows * terrain->num_columns * 8 * sizeof(float);
+    float* slope_factors = arenaAlloc(arena, bytes);
+    memcpy(slope_factors, terrain->slope_factors, bytes);
+    free(terrain->slope_factors);
+
+    terrain->slope_factors = slope_factors;
+    terrain->arena = arena;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "cell.h"
+#include <stddef.h>
+
+/// Read-only terrain loaded with the grid, shared between all clones of an automaton.
+/// The slope factor of every cell towards each of its 8 neighbours is computed once at load,
+/// so spreading only has to look it up.
+typedef struct Terrain {
+    float* elevation;     // meters, one per cell
+    float* slope_factors; // 8 per cell, ordered by `neighbourIndex`
+    size_t num_rows;
+    size_t num_columns;
+    float cell_size;      // meters between the centers of two adjacent cells
+    SimArena* arena;      // holds the slope factors once they are moved there, null while they are malloc'ed
+} Terrain;
+
+/// Takes ownership of `elevation` and precomputes the slope factors
+Terrain* createTerrain(float* elevation, size_t num_rows, size_t num_columns, float cell_size);
+void destroyTerrain(Terrain* terrain);
+
+/// Bytes `moveTerrainIntoArena` takes from an arena, 0 for no terrain
+size_t terrainArenaBytes(const Terrain* terrain);
+/// Copies the slope factors into the arena and frees the malloc'ed ones.
+/// The terrain has to be destroyed before the arena.
+void moveTerrainIntoArena(Terrain* terrain, SimArena* arena);
+
+/// Slope factor `a_h` for fire spreading from the cell at (row, col) to the neighbour at offset (dx, dy)
+static inline float slopeFactor(const Terrain* terrain, size_t row, size_t col, int dx, int dy) {
+    return terrain->slope_factors[(row * terrain->num_columns + col) * 8 + neighbourIndex(dx, dy)];
+}
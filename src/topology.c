@@ -0,0 +1,113 @@
+#define _GNU_SOURCE // pthread_setaffinity_np and the CPU_* macros
+#include "topology.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Bounded by the number of nodes the kernel supports
+#define MAX_NUMA_NODES 1024
+
+static void addCpu(NumaNode* node, size_t cpu) {
+    size_t* cpus = realloc(node->cpus, (node->num_cpus + 1) * sizeof(size_t));
+    if (!cpus) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    node->cpus = cpus;
+    node->cpus[node->num_cpus++] = cpu;
+}
+
+/// Parses a cpulist like "0-15,32-47" into the node
+static bool parseCpuList(FILE* fd, NumaNode* node) {
+    unsigned long first;
+    while (fscanf(fd, "%lu", &first) == 1) {
+        unsigned long last = first;
+        int next = fgetc(fd);
+        if (next == '-') {
+            if (fscanf(fd, "%lu", &last) != 1)
+                return false;
+            next = fgetc(fd);
+        }
+
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+            addCpu(node, (size_t)cpu);
+
+        if (next != ',')
+            break;
+    }
+    return node->num_cpus > 0;
+}
+
+static Topology singleNode(void) {
+    Topology topology = {
+        .nodes = calloc(1, sizeof(NumaNode)),
+        .num_nodes = 1,
+    };
+    if (!topology.nodes) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (long cpu = 0; cpu < (num_cpus > 0 ? num_cpus : 1); cpu++)
+        addCpu(&topology.nodes[0], (size_t)cpu);
+
+    return topology;
+}
+
+Topology readTopology(void) {
+    Topology topology = {
+        .nodes = nullptr,
+        .num_nodes = 0,
+    };
+
+    // Node ids can have holes, nodes without CPUs (memory only) are skipped
+    for (size_t id = 0; id < MAX_NUMA_NODES; id++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist", id);
+        FILE* fd = fopen(path, "r");
+        if (!fd)
+            continue;
+
+        NumaNode node = {
+            .cpus = nullptr,
+            .num_cpus = 0,
+        };
+        const bool has_cpus = parseCpuList(fd, &node);
+        fclose(fd);
+        if (!has_cpus) {
+            free(node.cpus);
+            continue;
+        }
+
+        NumaNode* nodes = realloc(topology.nodes, (topology.num_nodes + 1) * sizeof(NumaNode));
+        if (!nodes) {
+            fprintf(stderr, "Out Of Memory\n");
+            exit(EXIT_FAILURE);
+        }
+        topology.nodes = nodes;
+        topology.nodes[topology.num_nodes++] = node;
+    }
+
+    if (topology.num_nodes == 0)
+        return singleNode();
+
+    return topology;
+}
+
+void destroyTopology(Topology* topology) {
+    for (size_t node = 0; node < topology->num_nodes; node++)
+        free(topology->nodes[node].cpus);
+    free(topology->nodes);
+    topology->nodes = nullptr;
+    topology->num_nodes = 0;
+}
+
+bool pinThreadToCpu(size_t cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+
+typedef struct NumaNode {
+    size_t* cpus;
+    size_t num_cpus;
+} NumaNode;
+
+/// The NUMA nodes of the machine and the CPUs on each of them
+typedef struct Topology {
+    NumaNode* nodes;
+    size_t num_nodes;
+} Topology;
+
+/// Reads the topology from /sys/devices/system/node.
+/// Falls back to one node with every online CPU when that isn't available.
+Topology readTopology(void);
+void destroyTopology(Topology* topology);
+
+/// Pins the calling thread to one CPU, returns false if that isn't allowed
+bool pinThreadToCpu(size_t cpu);
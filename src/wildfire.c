@@ -0,0 +1,185 @@
+#include "wildfire.h"
+#include "arena.h"
+#include "burnout_cell.h"
+#include "cell.h"
+#include "input.h"
+#include "simulation.h"
+#include "terrain.h"
+#include "wind_field.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct WildfireContext {
+    CellularAutomaton initial; // as loaded, never stepped
+    CellularAutomaton state;
+    BurnoutWheel burnout;
+    SimArena* arena;
+    size_t num_cells;
+    bool owns_terrain; // clones share the terrain of the context they came from
+};
+
+WildfireContext* wildfireCreate(const char* cellgrid_path, const char* windfield_path) {
+    CellularAutomaton automaton = readInitialState(cellgrid_path);
+    if (automaton.num_rows == 0)
+        return nullptr;
+
+    if (windfield_path) {
+        automaton.wind = readWindField(windfield_path, automaton.num_rows, automaton.rows[0].count);
+        if (!automaton.wind) {
+            destroyTerrain(automaton.terrain);
+            destroyAutomaton(&automaton);
+            return nullptr;
+        }
+    }
+
+    return wildfireCreateFromAutomaton(&automaton);
+}
+
+static WildfireContext* createContext(CellularAutomaton* automaton, bool owns_terrain) {
+    WildfireContext* context = malloc(sizeof(WildfireContext));
+    if (!context) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The initial state, the current one and the one a step is writing, plus the burnout wheel and the
+    // wind field. The slope factors only if the terrain is ours, a clone reads them from the arena of its original.
+    const size_t num_rows = automaton->num_rows;
+    const size_t num_columns = automaton->rows[0].count;
+    context->num_cells = num_rows * num_columns;
+    context->owns_terrain = owns_terrain;
+    context->arena = createArena(arenaGridBytes(num_rows, num_columns, 3) + context->num_cells * sizeof(size_t) + ARENA_ALIGNMENT
+                                     + (owns_terrain ? terrainArenaBytes(automaton->terrain) : 0) + windFieldArenaBytes(automaton->wind),
+                                 ARENA_TRANSPARENT_HUGE_PAGES);
+    if (!context->arena) {
+        free(context);
+        return nullptr;
+    }
+    arenaReserveGrids(context->arena, num_rows, num_columns, 3);
+
+    automaton->step = 0;
+    automaton->burnout = nullptr;
+    context->initial = moveIntoArena(automaton, context->arena);
+    context->state = cloneAutomaton(&context->initial);
+    context->burnout = createBurnoutWheel(&context->state);
+    context->state.burnout = &context->burnout;
+    return context;
+}
+
+WildfireContext* wildfireCreateFromAutomaton(CellularAutomaton* automaton) {
+    return createContext(automaton, true);
+}
+
+WildfireContext* wildfireClone(const WildfireContext* context) {
+    // A plain copy of the cells as loaded, moved into the arena of the clone
+    CellularAutomaton initial = context->initial;
+    initial.arena = nullptr;
+    initial.burnout = nullptr;
+    initial = cloneAutomaton(&initial);
+    initial.windX = context->state.windX;
+    initial.windY = context->state.windY;
+    initial.speed = context->state.speed;
+
+    // The wind field changes frames as it steps, so every context needs its own
+    if (context->state.wind)
+        initial.wind = copyWindField(context->state.wind);
+
+    WildfireContext* clone = createContext(&initial, false);
+    if (!clone) {
+        destroyWindField(initial.wind);
+        destroyAutomaton(&initial);
+    }
+    return clone;
+}
+
+void wildfireDestroy(WildfireContext* context) {
+    if (context->owns_terrain)
+        destroyTerrain(context->state.terrain);
+    destroyWindField(context->state.wind);
+
+    // Everything else lives in the arena
+    destroyArena(context->arena);
+    free(context);
+}
+
+void wildfireReset(WildfireContext* context) {
+    CellularAutomaton* state = &context->state;
+    memcpy(state->rows[0].elements, context->initial.rows[0].elements, context->num_cells * sizeof(Cell));
+    state->step = 0;
+    resetBurnoutWheel(&context->burnout, state);
+    if (state->wind)
+        updateWindField(state->wind, 0);
+}
+
+bool wildfireIgnite(WildfireContext* context, size_t row, size_t col) {
+    CellularAutomaton* state = &context->state;
+    if (row >= state->num_rows || col >= state->rows[row].count)
+        return false;
+
+    Cell* cell = &state->rows[row].elements[col];
+    if (cell->state != CELLSTATE_NORMAL)
+        return false;
+
+    cell->state = CELLSTATE_ONFIRE;
+    cell->on_fire_counter = 0;
+    scheduleBurnout(&context->burnout, state->step, row, col, cell->type);
+    return true;
+}
+
+bool wildfireSetWind(WildfireContext* context, int windX, int windY, WindSpeed speed) {
+    if (windX < -1 || windX > 1 || windY < -1 || windY > 1 || speed >= WIND_LAST)
+        return false;
+
+    CellularAutomaton* state = &context->state;
+    state->windX = windX;
+    state->windY = windY;
+    state->speed = speed;
+
+    if (state->wind) {
+        destroyWindField(state->wind);
+        state->wind = nullptr;
+        context->initial.wind = nullptr;
+    }
+    return true;
+}
+
+size_t wildfireAdvance(WildfireContext* context, size_t max_steps) {
+    if (max_steps == 0)
+        return 0;
+
+    CellularAutomaton* state = &context->state;
+    const size_t skipped = skipIdleSteps(state, max_steps);
+    if (skipped >= max_steps)
+        return skipped;
+
+    stepAutomaton(state);
+    return skipped + 1;
+}
+
+void wildfireStep(WildfireContext* context, size_t steps) {
+    CellularAutomaton* state = &context->state;
+    for (size_t step = 0; step < steps;) {
+        // Jump over the steps where the fire can't do anything but wait to burn out
+        step += skipIdleSteps(state, steps - step);
+        if (step >= steps)
+            break;
+
+        stepAutomaton(state);
+        step++;
+    }
+}
+
+WildfireView wildfireState(const WildfireContext* context) {
+    const CellularAutomaton* state = &context->state;
+    return (WildfireView) {
+        .cells = state->rows[0].elements,
+        .num_rows = state->num_rows,
+        .num_columns = state->rows[0].count,
+        .step = state->step,
+    };
+}
+
+const CellularAutomaton* wildfireAutomaton(const WildfireContext* context) {
+    return &context->state;
+}
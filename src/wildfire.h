@@ -0,0 +1,57 @@
+#pragma once
+#include "cell.h"
+#include <stddef.h>
+
+/*
+ * libwildfire, the simulation without the viewer, for running many scenarios in one process.
+ *
+ * A context loads a grid, and its terrain and wind field if any, once. After that a scenario is
+ * a `wildfireReset`, a few `wildfireIgnite` and `wildfireSetWind` calls and `wildfireStep`,
+ * none of which read files or allocate. The state is read in place with `wildfireState`.
+ *
+ * The steps draw from the generator of the calling thread, seed it with `seedSimulation` from
+ * random.h for reproducible runs. Different contexts can be stepped on different threads at once.
+ */
+
+typedef struct WildfireContext WildfireContext;
+
+/// The cells of a context, row by row, owned by the context.
+/// Valid until the next call that changes the state of the context.
+typedef struct WildfireView {
+    const Cell* cells;
+    size_t num_rows;
+    size_t num_columns;
+    size_t step;
+} WildfireView;
+
+/// Loads the grid and an optional wind field (null for none).
+/// Returns null if either couldn't be read.
+WildfireContext* wildfireCreate(const char* cellgrid_path, const char* windfield_path);
+/// Takes over an automaton that was built in memory, along with its terrain and wind field
+WildfireContext* wildfireCreateFromAutomaton(CellularAutomaton* automaton);
+/// A new context with the same grid, terrain and wind in its initial state, for stepping on another thread.
+/// The terrain is shared, so `context` has to outlive the clone.
+WildfireContext* wildfireClone(const WildfireContext* context);
+void wildfireDestroy(WildfireContext* context);
+
+/// Puts the cells back how they were loaded and the step back to 0.
+/// The wind stays whatever it was last set to.
+void wildfireReset(WildfireContext* context);
+
+/// Sets an unburnt cell on fire. Returns false if it is outside the grid or not unburnt.
+bool wildfireIgnite(WildfireContext* context, size_t row, size_t col);
+
+/// Sets a uniform wind, replacing the wind field if the context had one.
+/// Returns false if the wind is invalid.
+bool wildfireSetWind(WildfireContext* context, int windX, int windY, WindSpeed speed);
+
+/// Runs `steps` steps, fast-forwarding where nothing changes
+void wildfireStep(WildfireContext* context, size_t steps);
+/// Skips the steps where nothing changes and runs the first one where something might, never more than
+/// `max_steps` in total. For callers looking at the state after every change.
+/// Returns the number of steps it advanced.
+size_t wildfireAdvance(WildfireContext* context, size_t max_steps);
+
+WildfireView wildfireState(const WildfireContext* context);
+/// The automaton itself, for the functions of the rest of the simulation. Don't destroy it.
+const CellularAutomaton* wildfireAutomaton(const WildfireContext* context);
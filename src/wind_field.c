@@ -0,0 +1,142 @@
+#include "wind_field.h"
+#include "arena.h"
+#include "cell.h"
+#include "direct_spread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void buildSpreadWeights(WindField* field) {
+    const WindFrame* frame = &field->frames[field->current_frame];
+    const size_t num_blocks = field->blocks_x * field->blocks_y;
+
+    for (size_t block = 0; block < num_blocks; block++) {
+        const BlockWind wind = frame->blocks[block];
+        float* weights = field->spread_weights + block * 8;
+
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0)
+                    continue;
+                weights[neighbourIndex(dx, dy)] = windFactor(wind.windX, wind.windY, wind.speed, dx, dy);
+            }
+        }
+    }
+}
+
+WindField* createWindField(WindFrame* frames, size_t num_frames, size_t block_size, size_t blocks_x, size_t blocks_y) {
+    assert(num_frames > 0 && frames[0].start_step == 0 && "The wind has to be known from the first step");
+
+    WindField* field = malloc(sizeof(WindField));
+    float* spread_weights = malloc(blocks_x * blocks_y * 8 * sizeof(float));
+    if (!field || !spread_weights) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *field = (WindField) {
+        .block_size = block_size,
+        .blocks_x = blocks_x,
+        .blocks_y = blocks_y,
+        .frames = frames,
+        .num_frames = num_frames,
+        .current_frame = 0,
+        .spread_weights = spread_weights,
+        .arena = nullptr,
+    };
+
+    buildSpreadWeights(field);
+    return field;
+}
+
+void destroyWindField(WindField* field) {
+    if (!field)
+        return;
+
+    // All the frames share one allocation of blocks
+    if (!field->arena) {
+        free(field->frames[0].blocks);
+        free(field->frames);
+        free(field->spread_weights);
+    }
+    free(field);
+}
+
+WindField* copyWindField(const WindField* field) {
+    const size_t num_blocks = field->blocks_x * field->blocks_y;
+    WindFrame* frames = malloc(field->num_frames * sizeof(WindFrame));
+    BlockWind* blocks = malloc(field->num_frames * num_blocks * sizeof(BlockWind));
+    if (!frames || !blocks) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t frame = 0; frame < field->num_frames; frame++) {
+        frames[frame] = (WindFrame) {
+            .start_step = field->frames[frame].start_step,
+            .blocks = blocks + frame * num_blocks,
+        };
+        memcpy(frames[frame].blocks, field->frames[frame].blocks, num_blocks * sizeof(BlockWind));
+    }
+
+    return createWindField(frames, field->num_frames, field->block_size, field->blocks_x, field->blocks_y);
+}
+
+size_t windFieldArenaBytes(const WindField* field) {
+    if (!field)
+        return 0;
+
+    const size_t num_blocks = field->blocks_x * field->blocks_y;
+    return field->num_frames * sizeof(WindFrame) + field->num_frames * num_blocks * sizeof(BlockWind)
+           + num_blocks * 8 * sizeof(float) + 3 * ARENA_ALIGNMENT;
+}
+
+void moveWindFieldIntoArena(WindField* field, SimArena* arena) {
+    assert(field->arena == nullptr && "The wind field is already in an arena");
+
+    const size_t num_blocks = field->blocks_x * field->blocks_y;
+    WindFrame* frames = arenaAlloc(arena, field->num_frames * sizeof(WindFrame));
+    BlockWind* blocks = arenaAlloc(arena, field->num_frames * num_blocks * sizeof(BlockWind));
+    float* spread_weights = arenaAlloc(arena, num_blocks * 8 * sizeof(float));
+
+    for (size_t frame = 0; frame < field->num_frames; frame++) {
+        frames[frame] = (WindFrame) {
+            .start_step = field->frames[frame].start_step,
+            .blocks = blocks + frame * num_blocks,
+        };
+    }
+    memcpy(blocks, field->frames[0].blocks, field->num_frames * num_blocks * sizeof(BlockWind));
+    memcpy(spread_weights, field->spread_weights, num_blocks * 8 * sizeof(float));
+
+    free(field->frames[0].blocks);
+    free(field->frames);
+    free(field->spread_weights);
+    field->frames = frames;
+    field->spread_weights = spread_weights;
+    field->arena = arena;
+}
+
+void updateWindField(WindField* field, size_t step) {
+    size_t frame = field->current_frame;
+
+    // Steps normally only move forward, but the field can be rewound for a new run
+    while (frame > 0 && field->frames[frame].start_step > step)
+        frame--;
+    while (frame + 1 < field->num_frames && field->frames[frame + 1].start_step <= step)
+        frame++;
+
+    if (frame == field->current_frame)
+        return;
+
+    field->current_frame = frame;
+    buildSpreadWeights(field);
+}
+
+size_t nextWindChange(const WindField* field, size_t step) {
+    for (size_t frame = field->current_frame; frame < field->num_frames; frame++) {
+        if (field->frames[frame].start_step > step)
+            return field->frames[frame].start_step;
+    }
+
+    return (size_t)-1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "cell.h"
+
+typedef struct BlockWind {
+    int windX;
+    int windY;
+    WindSpeed speed;
+} BlockWind;
+
+/// The wind of every block from `start_step` until the next frame starts
+typedef struct WindFrame {
+    size_t start_step;
+    BlockWind* blocks; // blocks_x * blocks_y, row by row
+} WindFrame;
+
+/// Coarse wind that varies per square block of cells and over time, e.g. from a weather model.
+/// The spread weights are rebuilt once per frame change, not per cell per step.
+struct WindField {
+    size_t block_size; // cells along each side of a block
+    size_t blocks_x;
+    size_t blocks_y;
+    WindFrame* frames; // sorted by start_step, the first one starts at step 0
+    size_t num_frames;
+    size_t current_frame;
+    float* spread_weights; // 8 wind factors per block of the current frame, ordered by `neighbourIndex`
+    SimArena* arena;       // holds the frames, blocks and spread weights once they are moved there
+};
+
+/// Takes ownership of `frames` and builds the spread weights of the first frame
+WindField* createWindField(WindFrame* frames, size_t num_frames, size_t block_size, size_t blocks_x, size_t blocks_y);
+void destroyWindField(WindField* field);
+/// Deep copy starting at the first frame, for simulations that step on their own. The copy is malloc'ed.
+WindField* copyWindField(const WindField* field);
+
+/// Bytes `moveWindFieldIntoArena` takes from an arena, 0 for no wind field
+size_t windFieldArenaBytes(const WindField* field);
+/// Copies the frames, their blocks and the spread weights into the arena and frees the malloc'ed ones.
+/// The wind field has to be destroyed before the arena.
+void moveWindFieldIntoArena(WindField* field, SimArena* arena);
+
+/// Switches to the frame active at `step`, rebuilding the spread weights if it changed
+void updateWindField(WindField* field, size_t step);
+
+/// Returns the first step after `step` where the wind changes, or (size_t)-1 if it never does
+size_t nextWindChange(const WindField* field, size_t step);
+
+static inline size_t windBlockIndex(const WindField* field, size_t row, size_t col) {
+    return (row / field->block_size) * field->blocks_x + col / field->block_size;
+}
+
+/// Wind at a cell, taken from the wind field if the automaton has one
+static inline BlockWind windAt(const CellularAutomaton* automaton, size_t row, size_t col) {
+    const WindField* field = automaton->wind;
+    if (!field) {
+        return (BlockWind) {
+            .windX = automaton->windX,
+            .windY = automaton->windY,
+            .speed = automaton->speed,
+        };
+    }
+
+    return field->frames[field->current_frame].blocks[windBlockIndex(field, row, col)];
+}
+
+/// The 8 wind factors for spreading out of the cell at (row, col)
+static inline const float* blockSpreadWeights(const WindField* field, size_t row, size_t col) {
+    return field->spread_weights + windBlockIndex(field, row, col) * 8;
+}
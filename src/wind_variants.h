@@ -0,0 +1,23 @@
+#pragma once
+
+// X-macros listing every uniform wind configuration, 9 directions times 5 speeds.
+// They are used to stamp out step kernels with the wind baked in as constants.
+// X is called as X(name, windX, windY, speed), where name is unique per direction.
+
+#define FOR_EACH_WIND_SPEED(X, name, windX, windY) \
+    X(name, windX, windY, 0) \
+    X(name, windX, windY, 1) \
+    X(name, windX, windY, 2) \
+    X(name, windX, windY, 3) \
+    X(name, windX, windY, 4)
+
+#define FOR_EACH_WIND_VARIANT(X) \
+    FOR_EACH_WIND_SPEED(X, nw, -1, -1) \
+    FOR_EACH_WIND_SPEED(X, n,   0, -1) \
+    FOR_EACH_WIND_SPEED(X, ne,  1, -1) \
+    FOR_EACH_WIND_SPEED(X, w,  -1,  0) \
+    FOR_EACH_WIND_SPEED(X, calm, 0, 0) \
+    FOR_EACH_WIND_SPEED(X, e,   1,  0) \
+    FOR_EACH_WIND_SPEED(X, sw, -1,  1) \
+    FOR_EACH_WIND_SPEED(X, s,   0,  1) \
+    FOR_EACH_WIND_SPEED(X, se,  1,  1)
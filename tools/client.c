@@ -0,0 +1,201 @@
+// Sends one scenario to wildfire-server and prints what comes back.
+// Usage: wildfire-client <socket> <grid> <windX> <windY> <speed> <steps> <realizations> <seed> <row,col>... [-o prefix]
+// With -o the burn probability and mean arrival time of every cell are written to <prefix>.burn and <prefix>.arrival.
+#include "scenario_protocol.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool writeAll(int fd, const void* data, size_t bytes) {
+    const uint8_t* left = data;
+    while (bytes > 0) {
+        const ssize_t written = write(fd, left, bytes);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        left += written;
+        bytes -= (size_t)written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t bytes) {
+    uint8_t* left = data;
+    while (bytes > 0) {
+        const ssize_t received = read(fd, left, bytes);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        left += received;
+        bytes -= (size_t)received;
+    }
+    return true;
+}
+
+static int connectTo(const char* path) {
+    struct sockaddr_un address = {
+        .sun_family = AF_UNIX,
+    };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "ERROR: socket path \"%s\" is too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (const struct sockaddr*)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "ERROR: couldn't connect to \"%s\": %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool writePlane(const char* prefix, const char* extension, const float* plane, size_t num_rows, size_t num_columns) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s.%s", prefix, extension);
+    FILE* fd = fopen(path, "w");
+    if (!fd) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return false;
+    }
+
+    for (size_t row = 0; row < num_rows; row++) {
+        for (size_t col = 0; col < num_columns; col++)
+            fprintf(fd, "%g,", (double)plane[row * num_columns + col]);
+        fputc('\n', fd);
+    }
+    return fclose(fd) == 0;
+}
+
+static bool printResult(int fd, size_t payload_bytes, const char* prefix) {
+    ScenarioResult result;
+    if (payload_bytes < sizeof(result) || !readAll(fd, &result, sizeof(result)))
+        return false;
+
+    const size_t num_cells = (size_t)result.num_rows * result.num_columns;
+    if (payload_bytes != sizeof(result) + 2 * num_cells * sizeof(float))
+        return false;
+
+    float* planes = malloc(2 * num_cells * sizeof(float));
+    if (!planes) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!readAll(fd, planes, 2 * num_cells * sizeof(float))) {
+        free(planes);
+        return false;
+    }
+
+    size_t ever_burned = 0;
+    for (size_t cell = 0; cell < num_cells; cell++)
+        ever_burned += planes[cell] > 0.0f;
+
+    printf("%u realizations of %u steps (batched with %u request(s))\n", result.realizations, result.steps, result.batch_size);
+    printf("burnt: %.2f +- %.2f cells, %zu cells burned at least once\n", result.mean_burnt, result.stddev_burnt, ever_burned);
+
+    bool ok = true;
+    if (prefix) {
+        ok = writePlane(prefix, "burn", planes, result.num_rows, result.num_columns)
+            && writePlane(prefix, "arrival", planes + num_cells, result.num_rows, result.num_columns);
+    }
+    free(planes);
+    return ok;
+}
+
+int main(int argc, char const* const* argv) {
+    const char* prefix = nullptr;
+    if (argc > 2 && strcmp(argv[argc - 2], "-o") == 0) {
+        prefix = argv[argc - 1];
+        argc -= 2;
+    }
+
+    if (argc < 9) {
+        fprintf(stderr, "Usage: %s <socket> <grid> <windX> <windY> <speed> <steps> <realizations> <seed> <row,col>... [-o prefix]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t num_ignitions = (uint32_t)(argc - 9);
+    ScenarioIgnition* ignitions = malloc((num_ignitions ? num_ignitions : 1) * sizeof(ScenarioIgnition));
+    if (!ignitions) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t index = 0; index < num_ignitions; index++) {
+        if (sscanf(argv[9 + index], "%u,%u", &ignitions[index].row, &ignitions[index].col) != 2) {
+            fprintf(stderr, "ERROR: ignition \"%s\" is not row,col\n", argv[9 + index]);
+            free(ignitions);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const ScenarioRequest request = {
+        .magic = SCENARIO_MAGIC,
+        .grid = (uint32_t)strtoul(argv[2], nullptr, 10),
+        .id = (uint64_t)getpid(),
+        .windX = (int32_t)strtol(argv[3], nullptr, 10),
+        .windY = (int32_t)strtol(argv[4], nullptr, 10),
+        .speed = (uint32_t)strtoul(argv[5], nullptr, 10),
+        .steps = (uint32_t)strtoul(argv[6], nullptr, 10),
+        .realizations = (uint32_t)strtoul(argv[7], nullptr, 10),
+        .seed = strtoull(argv[8], nullptr, 10),
+        .num_ignitions = num_ignitions,
+    };
+
+    const int fd = connectTo(argv[1]);
+    if (fd < 0) {
+        free(ignitions);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = writeAll(fd, &request, sizeof(request)) && writeAll(fd, ignitions, num_ignitions * sizeof(ScenarioIgnition));
+    free(ignitions);
+
+    // Realizations stream in as they finish, until the result or an error
+    bool done = false;
+    while (ok && !done) {
+        ScenarioFrame frame;
+        ok = readAll(fd, &frame, sizeof(frame)) && frame.magic == SCENARIO_MAGIC && frame.id == request.id;
+        if (!ok)
+            break;
+
+        switch (frame.type) {
+        case SCENARIO_FRAME_REALIZATION: {
+            ScenarioRealization realization;
+            ok = frame.payload_bytes == sizeof(realization) && readAll(fd, &realization, sizeof(realization));
+            if (ok)
+                printf("realization %u: %llu burnt, %llu burning\n", realization.realization,
+                       (unsigned long long)realization.burnt, (unsigned long long)realization.burning);
+            break;
+        }
+        case SCENARIO_FRAME_RESULT:
+            ok = printResult(fd, frame.payload_bytes, prefix);
+            done = true;
+            break;
+        case SCENARIO_FRAME_ERROR: {
+            char message[256] = {0};
+            const size_t length = frame.payload_bytes < sizeof(message) - 1 ? frame.payload_bytes : sizeof(message) - 1;
+            readAll(fd, message, length);
+            fprintf(stderr, "ERROR: %s\n", message);
+            ok = false;
+            done = true;
+            break;
+        }
+        default:
+            ok = false;
+            break;
+        }
+    }
+
+    if (!ok && !done)
+        fputs("ERROR: the server didn't finish the scenario\n", stderr);
+    close(fd);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
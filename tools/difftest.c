@@ -0,0 +1,795 @@
+// Checks the faster engines against the reference pipeline in distribution.
+// Usage: wildfire-difftest [-j threads] [-n runs] [-s seed] [engine...]
+//
+// The engines draw their random numbers in their own order, so their output never matches the
+// reference cell for cell. Instead every engine is run many times on a few synthetic grids, as is
+// `directSpreadGeneric`, `spottingSpreadGeneric` and `burnoutCells` with independent seeds, and the
+// two samples are compared:
+//   - the burnt area at the end, with a two sample Kolmogorov-Smirnov test
+//   - the spread rate, cells ignited per step over each quarter of the run, with the same test
+//   - the burn probability of every cell, with a two proportion z-test
+// The significance level is split over the tests (Bonferroni), so a correct engine fails a grid
+// about once in a thousand.
+// The exposure engine only returns the mean burnt area of a fire started in a cell, so it is checked
+// on that alone: the mean of as many reference runs from the middle of the fire of every grid, with
+// everything else unburnt, against the exposure of that cell, with a z-test.
+// Exits with failure if any engine fails any grid.
+#define _GNU_SOURCE // mkdtemp
+#include "cell.h"
+#include "cellbin.h"
+#include "direct_spread.h"
+#include "spotting_spread.h"
+#include "burnout_cell.h"
+#include "domain.h"
+#include "exposure.h"
+#include "parallel_step.h"
+#include "random.h"
+#include "stream_sim.h"
+#include "terrain.h"
+#include "wildfire.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_CHECKPOINTS 4
+#define RUNS_PER_TASK 16
+
+// Chance that a correct engine fails one grid
+static constexpr double family_alpha = 0.001;
+
+typedef struct TestGrid {
+    const char* name;
+    CellularAutomaton automaton; // initial state, its terrain belongs to `context`
+    WildfireContext* context;    // cloned by the engines built on libwildfire
+    size_t checkpoints[NUM_CHECKPOINTS];
+    size_t ignite_row;           // middle of the fire
+    size_t ignite_col;
+} TestGrid;
+
+/// Runs one realization from the grid, writing the cells reached by the fire (burning or burnt)
+/// after each checkpoint into `areas` and adding 1 to `reached` for every cell reached at the end.
+/// `scratch` is what `prepare` returned, kept for a task of several runs.
+typedef bool (*EngineRun)(const TestGrid* grid, void* scratch, uint64_t seed, size_t* areas, uint32_t* reached);
+
+typedef struct Engine {
+    const char* name;
+    const char* description;
+    void* (*prepare)(const TestGrid* grid);
+    void (*release)(void* scratch);
+    EngineRun run;
+    bool flat_only; // can't take a terrain, skipped on the grids with one
+} Engine;
+
+static size_t countReached(const Cell* cells, size_t num_cells, uint32_t* reached) {
+    size_t area = 0;
+    for (size_t index = 0; index < num_cells; index++) {
+        const bool hit = cells[index].state != CELLSTATE_NORMAL;
+        area += hit;
+        if (reached)
+            reached[index] += hit;
+    }
+    return area;
+}
+
+static size_t gridCells(const TestGrid* grid) {
+    return grid->automaton.num_rows * grid->automaton.rows[0].count;
+}
+
+// The pipeline as it is without any of the optimizations, one clone per phase and no burnout wheel
+static bool runReference(const TestGrid* grid, void* scratch, uint64_t seed, size_t* areas, uint32_t* reached) {
+    (void)scratch;
+    seedSimulation(seed);
+
+    CellularAutomaton automaton = cloneAutomaton(&grid->automaton);
+    size_t step = 0;
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++) {
+        for (; step < grid->checkpoints[checkpoint]; step++) {
+            CellularAutomaton next = directSpreadGeneric(&automaton);
+            destroyAutomaton(&automaton);
+            automaton = next;
+
+            next = spottingSpreadGeneric(&automaton);
+            destroyAutomaton(&automaton);
+            automaton = next;
+
+            next = burnoutCells(&automaton);
+            destroyAutomaton(&automaton);
+            automaton = next;
+        }
+
+        const bool last = checkpoint + 1 == NUM_CHECKPOINTS;
+        areas[checkpoint] = countReached(automaton.rows[0].elements, gridCells(grid), last ? reached : nullptr);
+    }
+
+    destroyAutomaton(&automaton);
+    return true;
+}
+
+static void* prepareContext(const TestGrid* grid) {
+    return wildfireClone(grid->context);
+}
+
+static void releaseContext(void* scratch) {
+    if (scratch)
+        wildfireDestroy(scratch);
+}
+
+// Specialized kernels, the burnout wheel and the arena, as stepped by libwildfire
+static bool runContext(const TestGrid* grid, void* scratch, uint64_t seed, size_t* areas, uint32_t* reached) {
+    WildfireContext* context = scratch;
+    if (!context)
+        return false;
+
+    seedSimulation(seed);
+    wildfireReset(context);
+    size_t step = 0;
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++) {
+        wildfireStep(context, grid->checkpoints[checkpoint] - step);
+        step = grid->checkpoints[checkpoint];
+
+        const WildfireView view = wildfireState(context);
+        const bool last = checkpoint + 1 == NUM_CHECKPOINTS;
+        areas[checkpoint] = countReached(view.cells, gridCells(grid), last ? reached : nullptr);
+    }
+    return true;
+}
+
+// Row bands on two threads with a generator each
+static bool runParallel(const TestGrid* grid, void* scratch, uint64_t seed, size_t* areas, uint32_t* reached) {
+    (void)scratch;
+    ParallelStepper* stepper = createParallelStepper(&grid->automaton, 2, false, seed);
+    if (!stepper)
+        return false;
+
+    size_t step = 0;
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++) {
+        runParallelSteps(stepper, grid->checkpoints[checkpoint] - step);
+        step = grid->checkpoints[checkpoint];
+
+        const CellularAutomaton state = parallelStepperState(stepper);
+        const bool last = checkpoint + 1 == NUM_CHECKPOINTS;
+        areas[checkpoint] = countReached(state.rows[0].elements, gridCells(grid), last ? reached : nullptr);
+    }
+
+    destroyParallelStepper(stepper);
+    return true;
+}
+
+// Two processes swapping halos. Only the end state comes back, so every checkpoint is a run of its own,
+// which gives the same states as stopping one run since the processes draw the same numbers either way.
+static bool runDecomposedEngine(const TestGrid* grid, void* scratch, uint64_t seed, size_t* areas, uint32_t* reached) {
+    (void)scratch;
+    const size_t halo = domainHaloRows(&grid->automaton);
+    const size_t processes = grid->automaton.num_rows >= 2 * halo ? 2 : 1;
+
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++) {
+        CellularAutomaton result;
+        if (!runDecomposed(&grid->automaton, processes, grid->checkpoints[checkpoint], seed, &result))
+            return false;
+
+        const bool last = checkpoint + 1 == NUM_CHECKPOINTS;
+        areas[checkpoint] = countReached(result.rows[0].elements, gridCells(grid), last ? reached : nullptr);
+        destroyAutomaton(&result);
+    }
+    return true;
+}
+
+/// Directory of a task of the stream engine, with the grid as a .cellbin and the result of the last run
+typedef struct StreamFiles {
+    char dir[64];
+    char in_path[96];
+    char out_path[96];
+} StreamFiles;
+
+static void* prepareStream(const TestGrid* grid) {
+    StreamFiles* files = malloc(sizeof(StreamFiles));
+    if (!files) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    snprintf(files->dir, sizeof(files->dir), "/tmp/wildfire-difftest-XXXXXX");
+    if (!mkdtemp(files->dir)) {
+        fprintf(stderr, "Failed to create a directory in /tmp for the stream engine\n");
+        free(files);
+        return nullptr;
+    }
+    snprintf(files->in_path, sizeof(files->in_path), "%s/in.cellbin", files->dir);
+    snprintf(files->out_path, sizeof(files->out_path), "%s/out.cellbin", files->dir);
+
+    if (!writeCellbin(&grid->automaton, files->in_path)) {
+        rmdir(files->dir);
+        free(files);
+        return nullptr;
+    }
+    return files;
+}
+
+static void releaseStream(void* scratch) {
+    StreamFiles* files = scratch;
+    if (!files)
+        return;
+
+    unlink(files->in_path);
+    unlink(files->out_path);
+    rmdir(files->dir);
+    free(files);
+}
+
+// Out-of-core over memory mapped .cellbin files. Like the decomposed engine only the end state comes
+// back, so every checkpoint is a run of its own, which draws the same numbers up to it.
+static bool runStream(const TestGrid* grid, void* scratch, uint64_t seed, size_t* areas, uint32_t* reached) {
+    const StreamFiles* files = scratch;
+    if (!files)
+        return false;
+
+    const StreamOptions options = {
+        .seed = seed,
+    };
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++) {
+        if (!streamSimulate(files->in_path, files->out_path, grid->checkpoints[checkpoint], &options, nullptr))
+            return false;
+
+        CellularAutomaton result = readCellbin(files->out_path);
+        if (!result.rows)
+            return false;
+
+        const bool last = checkpoint + 1 == NUM_CHECKPOINTS;
+        areas[checkpoint] = countReached(result.rows[0].elements, gridCells(grid), last ? reached : nullptr);
+        destroyAutomaton(&result);
+    }
+    return true;
+}
+
+// The first one is the reference, which is also a candidate for checking the harness itself
+static const Engine engines[] = {
+    {
+        .name = "reference",
+        .description = "the reference itself with other seeds, which should always pass",
+        .run = runReference,
+    },
+    {
+        .name = "context",
+        .description = "libwildfire: specialized kernels, burnout wheel and arena",
+        .prepare = prepareContext,
+        .release = releaseContext,
+        .run = runContext,
+    },
+    {
+        .name = "parallel",
+        .description = "parallel step over row bands on 2 threads",
+        .run = runParallel,
+    },
+    {
+        .name = "decomposed",
+        .description = "domain decomposition over 2 processes",
+        .run = runDecomposedEngine,
+    },
+    {
+        .name = "stream",
+        .description = "out-of-core over .cellbin files, on the grids without terrain",
+        .prepare = prepareStream,
+        .release = releaseStream,
+        .run = runStream,
+        .flat_only = true,
+    },
+};
+#define NUM_ENGINES (sizeof(engines) / sizeof(engines[0]))
+
+/// Mixed vegetation and moisture with a 3x3 fire around (ignite_row, ignite_col), the same for the same seed.
+/// The moisture is in whole percent, like the .cellbin format keeps it.
+static TestGrid makeTestGrid(const char* name, size_t num_rows, size_t num_columns, int windX, int windY, WindSpeed speed,
+                             size_t ignite_row, size_t ignite_col, bool hills, size_t steps, uint64_t seed) {
+    static const VegType types[] = {
+        VEG_BROADLEAVES, VEG_SHRUBS, VEG_GRASSLAND, VEG_FIREPRONE, VEG_AGROFORESTRY, VEG_NOTFIREPRONE,
+    };
+
+    CellArray* rows = malloc(num_rows * sizeof(CellArray));
+    Cell* cells = malloc(num_rows * num_columns * sizeof(Cell));
+    float* elevation = hills ? malloc(num_rows * num_columns * sizeof(float)) : nullptr;
+    if (!rows || !cells || (hills && !elevation)) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    Rng rng = seedRng(seed);
+    for (size_t row = 0; row < num_rows; row++) {
+        rows[row] = (CellArray) {
+            .elements = cells + row * num_columns,
+            .count = num_columns,
+        };
+        for (size_t col = 0; col < num_columns; col++) {
+            const bool ignited = row + 1 >= ignite_row && row <= ignite_row + 1 && col + 1 >= ignite_col && col <= ignite_col + 1;
+            cells[row * num_columns + col] = (Cell) {
+                .moisture = (float)(10 + rngNext(&rng) % 51) / 100.f,
+                .on_fire_counter = 0,
+                .type = types[rngNext(&rng) % (sizeof(types) / sizeof(types[0]))],
+                .state = ignited ? CELLSTATE_ONFIRE : CELLSTATE_NORMAL,
+            };
+            if (hills)
+                elevation[row * num_columns + col] = 40.f * sinf((float)row / 7.f) + 25.f * cosf((float)col / 5.f) + 2.f * (float)row;
+        }
+    }
+
+    TestGrid grid = {
+        .name = name,
+        .automaton = {
+            .rows = rows,
+            .num_rows = num_rows,
+            .windX = windX,
+            .windY = windY,
+            .speed = speed,
+            .terrain = hills ? createTerrain(elevation, num_rows, num_columns, 30.f) : nullptr,
+        },
+        .ignite_row = ignite_row,
+        .ignite_col = ignite_col,
+    };
+
+    // The context gets a copy and the terrain, which it frees along with itself
+    CellularAutomaton copy = cloneAutomaton(&grid.automaton);
+    grid.context = wildfireCreateFromAutomaton(&copy);
+    if (!grid.context) {
+        fprintf(stderr, "Failed to create a context for grid %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++)
+        grid.checkpoints[checkpoint] = steps * (checkpoint + 1) / NUM_CHECKPOINTS;
+    return grid;
+}
+
+/// Samples of one engine on one grid
+typedef struct Sample {
+    size_t* areas; // NUM_CHECKPOINTS per run
+    uint32_t* reached;
+    size_t failed_runs;
+} Sample;
+
+typedef struct Task {
+    size_t grid;
+    size_t side; // 0 for the reference, the index of the candidate + 1 otherwise
+    size_t first_run;
+} Task;
+
+typedef struct Harness {
+    const TestGrid* grids;
+    size_t num_grids;
+    const Engine** engines; // the reference, then the candidates
+    size_t num_sides;
+    Sample* samples;        // num_grids * num_sides
+    size_t runs;
+    uint64_t seed;
+    Task* tasks;
+    size_t num_tasks;
+    size_t next_task;
+    pthread_mutex_t lock;
+} Harness;
+
+static void runTask(Harness* harness, const Task* task) {
+    const TestGrid* grid = &harness->grids[task->grid];
+    const Engine* engine = harness->engines[task->side];
+    Sample* sample = &harness->samples[task->grid * harness->num_sides + task->side];
+    const size_t num_cells = gridCells(grid);
+
+    uint32_t* reached = calloc(num_cells, sizeof(uint32_t));
+    if (!reached) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    void* scratch = engine->prepare ? engine->prepare(grid) : nullptr;
+    size_t failed = 0;
+    const size_t end_run = task->first_run + RUNS_PER_TASK < harness->runs ? task->first_run + RUNS_PER_TASK : harness->runs;
+    for (size_t run = task->first_run; run < end_run; run++) {
+        // Every grid, side and run gets its own stream, the reference and the candidates never share one
+        const uint64_t seed = harness->seed * 0x100000001B3ull + ((task->grid * 64 + task->side) << 32) + run;
+        failed += !engine->run(grid, scratch, seed, &sample->areas[run * NUM_CHECKPOINTS], reached);
+    }
+    if (engine->release)
+        engine->release(scratch);
+
+    pthread_mutex_lock(&harness->lock);
+    for (size_t index = 0; index < num_cells; index++)
+        sample->reached[index] += reached[index];
+    sample->failed_runs += failed;
+    pthread_mutex_unlock(&harness->lock);
+    free(reached);
+}
+
+static void* harnessWorkerMain(void* userdata) {
+    Harness* harness = userdata;
+    for (;;) {
+        pthread_mutex_lock(&harness->lock);
+        const size_t index = harness->next_task++;
+        pthread_mutex_unlock(&harness->lock);
+        if (index >= harness->num_tasks)
+            return nullptr;
+
+        runTask(harness, &harness->tasks[index]);
+    }
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/// Two sample Kolmogorov-Smirnov statistic, the largest distance between the empirical distributions.
+/// Sorts both samples.
+static double ksStatistic(double* a, size_t num_a, double* b, size_t num_b) {
+    qsort(a, num_a, sizeof(double), compareDoubles);
+    qsort(b, num_b, sizeof(double), compareDoubles);
+
+    double distance = 0.0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < num_a && j < num_b) {
+        // Step over every copy of the smallest value left in either sample, ties move together
+        const double value = a[i] < b[j] ? a[i] : b[j];
+        while (i < num_a && a[i] == value)
+            i++;
+        while (j < num_b && b[j] == value)
+            j++;
+
+        const double gap = fabs((double)i / (double)num_a - (double)j / (double)num_b);
+        distance = gap > distance ? gap : distance;
+    }
+    return distance;
+}
+
+/// Asymptotic p-value of the statistic (Numerical Recipes' probks), conservative for discrete samples
+static double ksPValue(double distance, size_t num_a, size_t num_b) {
+    const double effective = sqrt((double)num_a * (double)num_b / (double)(num_a + num_b));
+    const double lambda = (effective + 0.12 + 0.11 / effective) * distance;
+    if (lambda < 0.2)
+        return 1.0;
+
+    double sum = 0.0;
+    double sign = 1.0;
+    for (int term = 1; term <= 100; term++) {
+        const double value = sign * exp(-2.0 * term * term * lambda * lambda);
+        sum += value;
+        if (fabs(value) < 1e-12 * sum)
+            break;
+        sign = -sign;
+    }
+    const double p = 2.0 * sum;
+    return p < 0.0 ? 0.0 : p > 1.0 ? 1.0 : p;
+}
+
+/// z of the difference between how often a cell burnt in two samples of `runs` runs each,
+/// NaN for a cell that burnt in every run or in none, which says nothing
+static double twoProportionZ(uint32_t hits_a, uint32_t hits_b, size_t runs) {
+    const double hits = (double)hits_a + (double)hits_b;
+    if (hits == 0.0 || hits == 2.0 * (double)runs)
+        return NAN;
+
+    const double pooled = hits / (2.0 * (double)runs);
+    const double error = sqrt(pooled * (1.0 - pooled) * 2.0 / (double)runs);
+    return ((double)hits_a - (double)hits_b) / (double)runs / error;
+}
+
+typedef struct Comparison {
+    double area_p;
+    double rate_p; // lowest over the quarters
+    double cell_p; // lowest over the cells
+    double max_z;
+    size_t cells_tested;
+    size_t cells_failed;
+    bool passed;
+} Comparison;
+
+static Comparison compareSamples(const TestGrid* grid, const Sample* reference, const Sample* candidate, size_t runs) {
+    double* a = malloc(runs * sizeof(double));
+    double* b = malloc(runs * sizeof(double));
+    if (!a || !b) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    Comparison comparison = {
+        .rate_p = 1.0,
+        .cell_p = 1.0,
+    };
+
+    // The area at the end and the rate over each quarter, plus the family of per cell tests
+    const size_t num_tests = 1 + NUM_CHECKPOINTS + 1;
+    const double test_alpha = family_alpha / (double)num_tests;
+
+    for (size_t run = 0; run < runs; run++) {
+        a[run] = (double)reference->areas[run * NUM_CHECKPOINTS + NUM_CHECKPOINTS - 1];
+        b[run] = (double)candidate->areas[run * NUM_CHECKPOINTS + NUM_CHECKPOINTS - 1];
+    }
+    comparison.area_p = ksPValue(ksStatistic(a, runs, b, runs), runs, runs);
+
+    for (size_t checkpoint = 0; checkpoint < NUM_CHECKPOINTS; checkpoint++) {
+        const size_t first_step = checkpoint ? grid->checkpoints[checkpoint - 1] : 0;
+        const double steps = (double)(grid->checkpoints[checkpoint] - first_step);
+        for (size_t run = 0; run < runs; run++) {
+            const size_t* ref = &reference->areas[run * NUM_CHECKPOINTS];
+            const size_t* cand = &candidate->areas[run * NUM_CHECKPOINTS];
+            a[run] = (double)(ref[checkpoint] - (checkpoint ? ref[checkpoint - 1] : 0)) / steps;
+            b[run] = (double)(cand[checkpoint] - (checkpoint ? cand[checkpoint - 1] : 0)) / steps;
+        }
+        const double p = ksPValue(ksStatistic(a, runs, b, runs), runs, runs);
+        comparison.rate_p = p < comparison.rate_p ? p : comparison.rate_p;
+    }
+    free(a);
+    free(b);
+
+    const size_t num_cells = gridCells(grid);
+    for (size_t index = 0; index < num_cells; index++) {
+        const double z = twoProportionZ(reference->reached[index], candidate->reached[index], runs);
+        if (isnan(z))
+            continue;
+        comparison.cells_tested++;
+
+        const double p = erfc(fabs(z) / sqrt(2.0));
+        comparison.max_z = fabs(z) > comparison.max_z ? fabs(z) : comparison.max_z;
+        comparison.cell_p = p < comparison.cell_p ? p : comparison.cell_p;
+    }
+    const double cell_alpha = comparison.cells_tested ? test_alpha / (double)comparison.cells_tested : test_alpha;
+    for (size_t index = 0; index < num_cells; index++) {
+        const double z = twoProportionZ(reference->reached[index], candidate->reached[index], runs);
+        comparison.cells_failed += !isnan(z) && erfc(fabs(z) / sqrt(2.0)) < cell_alpha;
+    }
+
+    comparison.passed = reference->failed_runs == 0 && candidate->failed_runs == 0 && comparison.area_p >= test_alpha
+                        && comparison.rate_p >= test_alpha && comparison.cells_failed == 0;
+    return comparison;
+}
+
+typedef struct ExposureCheck {
+    double reference_mean;
+    double exposure_mean;
+    double z;
+    double p;
+    bool passed;
+} ExposureCheck;
+
+/// Runs the reference `runs` times from the cell in the middle of the fire of the grid alone and
+/// compares the mean burnt area with the exposure of that cell over as many realizations.
+/// The exposure only gives the mean, so the variance of both is taken from the reference runs.
+static ExposureCheck checkExposure(const TestGrid* grid, size_t grid_index, size_t runs, uint64_t seed, size_t num_threads) {
+    const size_t num_cells = gridCells(grid);
+    const size_t start = grid->ignite_row * grid->automaton.rows[0].count + grid->ignite_col;
+
+    TestGrid single = *grid;
+    single.automaton = cloneAutomaton(&grid->automaton);
+    Cell* cells = single.automaton.rows[0].elements;
+    for (size_t index = 0; index < num_cells; index++) {
+        if (cells[index].state == CELLSTATE_ONFIRE)
+            cells[index].state = CELLSTATE_NORMAL;
+    }
+    cells[start].state = CELLSTATE_ONFIRE;
+
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    size_t areas[NUM_CHECKPOINTS];
+    for (size_t run = 0; run < runs; run++) {
+        runReference(&single, nullptr, seed * 0x100000001B3ull + ((grid_index * 64 + 63) << 32) + run, areas, nullptr);
+        const double area = (double)areas[NUM_CHECKPOINTS - 1];
+        sum += area;
+        sum_squares += area * area;
+    }
+
+    const ExposureOptions options = {
+        .realizations = runs,
+        .max_steps = grid->checkpoints[NUM_CHECKPOINTS - 1],
+        .seed = seed * 0x9E3779B97F4A7C15ull + grid_index,
+        .num_threads = num_threads,
+        .cells = &start,
+        .num_cells = 1,
+    };
+    float* exposure = computeExposure(&single.automaton, &options, nullptr);
+    destroyAutomaton(&single.automaton);
+    if (!exposure)
+        return (ExposureCheck) {0};
+
+    ExposureCheck check = {
+        .reference_mean = sum / (double)runs,
+        .exposure_mean = exposure[start],
+    };
+    free(exposure);
+
+    const double variance = (sum_squares - sum * check.reference_mean) / (double)(runs - 1);
+    const double difference = check.reference_mean - check.exposure_mean;
+    if (variance > 0.0) {
+        check.z = difference / sqrt(variance * 2.0 / (double)runs);
+        check.p = erfc(fabs(check.z) / sqrt(2.0));
+    } else {
+        // Every reference run burnt the same, the exposure can't be off by more than its float
+        check.p = fabs(difference) < 1e-3 * (1.0 + check.reference_mean) ? 1.0 : 0.0;
+    }
+    check.passed = check.p >= family_alpha;
+    return check;
+}
+
+static const Engine* findEngine(const char* name) {
+    for (size_t index = 0; index < NUM_ENGINES; index++) {
+        if (strcmp(engines[index].name, name) == 0)
+            return &engines[index];
+    }
+    return nullptr;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [-j threads] [-n runs] [-s seed] [engine...]\nEngines:\n", program);
+    for (size_t index = 0; index < NUM_ENGINES; index++)
+        fprintf(stderr, "  %-11s %s\n", engines[index].name, engines[index].description);
+    fprintf(stderr, "  %-11s %s\n", "exposure", "ignition exposure, only its mean burnt area from a single ignition");
+}
+
+int main(int argc, char const* const* argv) {
+    size_t num_threads = 0;
+    size_t runs = 400;
+    uint64_t seed = 1;
+    const Engine* sides[1 + NUM_ENGINES] = {&engines[0]};
+    size_t num_sides = 1;
+    bool check_exposure = false;
+
+    for (int arg = 1; arg < argc; arg++) {
+        if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+            num_threads = (size_t)strtoul(argv[++arg], nullptr, 10);
+        } else if (arg + 1 < argc && strcmp(argv[arg], "-n") == 0) {
+            runs = (size_t)strtoul(argv[++arg], nullptr, 10);
+        } else if (arg + 1 < argc && strcmp(argv[arg], "-s") == 0) {
+            seed = strtoull(argv[++arg], nullptr, 10);
+        } else if (strcmp(argv[arg], "exposure") == 0) {
+            check_exposure = true;
+        } else {
+            const Engine* engine = findEngine(argv[arg]);
+            if (!engine || num_sides == 1 + NUM_ENGINES) {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            sides[num_sides++] = engine;
+        }
+    }
+    if (runs < 2) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    // Without any named, everything but the reference against itself
+    if (num_sides == 1 && !check_exposure) {
+        for (size_t index = 1; index < NUM_ENGINES; index++)
+            sides[num_sides++] = &engines[index];
+        check_exposure = true;
+    }
+    if (num_threads == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t)online : 1;
+    }
+
+    // Small enough to run often, between them they cover the wind kernels, the slope,
+    // the edges of the grid where firebrands count their neighbours differently, and long burnouts
+    TestGrid grids[] = {
+        makeTestGrid("se-fast", 48, 48, 1, 1, WIND_FAST, 12, 12, false, 40, 11),
+        makeTestGrid("calm", 48, 48, 0, 0, WIND_NONE, 24, 24, false, 40, 12),
+        makeTestGrid("w-hills", 48, 64, -1, 0, WIND_MODERATE, 20, 50, true, 40, 13),
+        makeTestGrid("s-extreme-edge", 64, 40, 0, 1, WIND_EXTREME, 0, 0, false, 40, 14),
+    };
+    const size_t num_grids = sizeof(grids) / sizeof(grids[0]);
+
+    const size_t tasks_per_sample = (runs + RUNS_PER_TASK - 1) / RUNS_PER_TASK;
+    Harness harness = {
+        .grids = grids,
+        .num_grids = num_grids,
+        .engines = sides,
+        .num_sides = num_sides,
+        .samples = calloc(num_grids * num_sides, sizeof(Sample)),
+        .runs = runs,
+        .seed = seed,
+        .tasks = malloc(num_grids * num_sides * tasks_per_sample * sizeof(Task)),
+    };
+    if (!harness.samples || !harness.tasks) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&harness.lock, nullptr);
+
+    for (size_t grid = 0; grid < num_grids; grid++) {
+        for (size_t side = 0; side < num_sides; side++) {
+            Sample* sample = &harness.samples[grid * num_sides + side];
+            sample->areas = malloc(runs * NUM_CHECKPOINTS * sizeof(size_t));
+            sample->reached = calloc(gridCells(&grids[grid]), sizeof(uint32_t));
+            if (!sample->areas || !sample->reached) {
+                fprintf(stderr, "Out Of Memory\n");
+                exit(EXIT_FAILURE);
+            }
+            if (sides[side]->flat_only && grids[grid].automaton.terrain)
+                continue;
+
+            for (size_t first_run = 0; first_run < runs; first_run += RUNS_PER_TASK) {
+                harness.tasks[harness.num_tasks++] = (Task) {
+                    .grid = grid,
+                    .side = side,
+                    .first_run = first_run,
+                };
+            }
+        }
+    }
+
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+
+    pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+    if (!threads) {
+        fprintf(stderr, "Out Of Memory\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], nullptr, harnessWorkerMain, &harness) != 0)
+            break;
+    }
+    if (started == 0)
+        harnessWorkerMain(&harness);
+    for (size_t index = 0; index < started; index++)
+        pthread_join(threads[index], nullptr);
+    free(threads);
+
+    ExposureCheck exposure_checks[sizeof(grids) / sizeof(grids[0])] = {0};
+    if (check_exposure) {
+        for (size_t grid = 0; grid < num_grids; grid++)
+            exposure_checks[grid] = checkExposure(&grids[grid], grid, runs, seed, num_threads);
+    }
+
+    timespec_get(&end, TIME_UTC);
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%zu runs per engine and grid, %zu threads, %.2f s, failing below p = %g per grid\n",
+           runs, started ? started : 1, seconds, family_alpha);
+    printf("%-15s %-11s %10s %10s %8s %7s %7s  %s\n", "grid", "engine", "area p", "rate p", "max |z|", "cells", "failed", "result");
+
+    bool all_passed = true;
+    for (size_t grid = 0; grid < num_grids; grid++) {
+        const Sample* reference = &harness.samples[grid * num_sides];
+        for (size_t side = 1; side < num_sides; side++) {
+            if (sides[side]->flat_only && grids[grid].automaton.terrain) {
+                printf("%-15s %-11s %10s %10s %8s %7s %7s  %s\n", grids[grid].name, sides[side]->name, "-", "-", "-", "-", "-",
+                       "skipped, no terrain");
+                continue;
+            }
+
+            const Sample* candidate = &harness.samples[grid * num_sides + side];
+            const Comparison comparison = compareSamples(&grids[grid], reference, candidate, runs);
+            all_passed &= comparison.passed;
+
+            printf("%-15s %-11s %10.3g %10.3g %8.2f %7zu %7zu  %s", grids[grid].name, sides[side]->name,
+                   comparison.area_p, comparison.rate_p, comparison.max_z, comparison.cells_tested,
+                   comparison.cells_failed, comparison.passed ? "pass" : "FAIL");
+            if (candidate->failed_runs || reference->failed_runs)
+                printf(" (%zu runs failed)", candidate->failed_runs + reference->failed_runs);
+            putchar('\n');
+        }
+
+        if (check_exposure) {
+            const ExposureCheck* check = &exposure_checks[grid];
+            all_passed &= check->passed;
+            printf("%-15s %-11s %10.3g %10s %8.2f %7s %7s  %s (mean area %.1f, reference %.1f)\n", grids[grid].name,
+                   "exposure", check->p, "-", fabs(check->z), "-", "-", check->passed ? "pass" : "FAIL",
+                   check->exposure_mean, check->reference_mean);
+        }
+    }
+
+    for (size_t index = 0; index < num_grids * num_sides; index++) {
+        free(harness.samples[index].areas);
+        free(harness.samples[index].reached);
+    }
+    free(harness.samples);
+    free(harness.tasks);
+    pthread_mutex_destroy(&harness.lock);
+    for (size_t grid = 0; grid < num_grids; grid++) {
+        wildfireDestroy(grids[grid].context);
+        destroyAutomaton(&grids[grid].automaton);
+    }
+
+    return all_passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
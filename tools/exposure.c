@@ -0,0 +1,73 @@
+// Writes the expected number of cells burnt by a fire starting in every cell of a grid, see exposure.h.
+// Usage: wildfire-exposure [-j threads] <grid.cellgrid> <out.csv> [realizations] [max steps] [seed]
+#include "cell.h"
+#include "exposure.h"
+#include "input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int main(int argc, char const* const* argv) {
+    ExposureOptions options = {
+        .realizations = 10,
+        .max_steps = 200,
+        .seed = 1,
+        .num_threads = 0,
+    };
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        options.num_threads = (size_t)strtoul(argv[2], nullptr, 10);
+        arg = 3;
+    }
+
+    if (argc - arg < 2 || argc - arg > 5) {
+        fprintf(stderr, "Usage: %s [-j threads] <grid.cellgrid> <out.csv> [realizations] [max steps] [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (argc - arg > 2)
+        options.realizations = (size_t)strtoul(argv[arg + 2], nullptr, 10);
+    if (argc - arg > 3)
+        options.max_steps = (size_t)strtoul(argv[arg + 3], nullptr, 10);
+    if (argc - arg > 4)
+        options.seed = strtoull(argv[arg + 4], nullptr, 10);
+    if (options.realizations == 0) {
+        fprintf(stderr, "ERROR: needs at least one realization\n");
+        return EXIT_FAILURE;
+    }
+
+    CellularAutomaton automaton = readInitialState(argv[arg]);
+    if (automaton.num_rows == 0)
+        return EXIT_FAILURE;
+
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+
+    ExposureStats stats;
+    float* exposure = computeExposure(&automaton, &options, &stats);
+
+    timespec_get(&end, TIME_UTC);
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    const size_t num_rows = automaton.num_rows;
+    const size_t num_columns = automaton.rows[0].count;
+    destroyAutomaton(&automaton);
+    if (!exposure)
+        return EXIT_FAILURE;
+
+    double sum = 0.0;
+    float highest = 0.0f;
+    for (size_t cell = 0; cell < num_rows * num_columns; cell++) {
+        sum += exposure[cell];
+        highest = exposure[cell] > highest ? exposure[cell] : highest;
+    }
+
+    printf("%zu fires in %.3f s (%.0f fires/s), %.1f steps per fire, %zu cut off after %zu steps\n",
+           stats.fires, seconds, (double)stats.fires / seconds,
+           stats.fires ? (double)stats.steps / (double)stats.fires : 0.0, stats.cut_off, options.max_steps);
+    printf("exposure: mean %.2f cells, highest %.2f cells\n", sum / (double)(num_rows * num_columns), (double)highest);
+
+    const bool ok = writeExposureRaster(argv[arg + 1], exposure, num_rows, num_columns);
+    free(exposure);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,128 @@
+// Generates a procedural grid as a .cellgrid and a .cellbin, see gridgen.h.
+// Usage: wildfire-gridgen [options] <width> <height> <out prefix>
+#include "gridgen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_IGNITIONS 1024
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] <width> <height> <out prefix>\n"
+            "Writes <out prefix>.cellgrid and <out prefix>.cellbin\n"
+            "  -s seed             seed of the noise, strips and random ignitions (1)\n"
+            "  -w windX,windY,speed                                      (1,0,2)\n"
+            "  -p cells            size of the fuel patches (64)\n"
+            "  -m dry,wet          moisture percent at the top and bottom rows (20,60)\n"
+            "  -r rivers           meandering soaked strips (2)\n"
+            "  -b firebreaks       straight strips (2)\n"
+            "  -i row,col          ignition point, can be repeated\n"
+            "  -n ignitions        random ignition points (0)\n"
+            "  -e meters           cell size, adds an elevation to the .cellgrid\n"
+            "  -f text|bin|both    which files to write (both)\n"
+            "  -j threads          0 for one per CPU (0)\n",
+            program);
+}
+
+int main(int argc, char const* const* argv) {
+    static GridGenIgnition ignitions[MAX_IGNITIONS];
+    GridGenOptions options = {
+        .seed = 1,
+        .windX = 1,
+        .windY = 0,
+        .speed = WIND_MODERATE,
+        .patch_size = 64.0f,
+        .dry_moisture = 20,
+        .wet_moisture = 60,
+        .num_rivers = 2,
+        .num_firebreaks = 2,
+        .ignitions = ignitions,
+    };
+    bool write_text = true;
+    bool write_bin = true;
+
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        const char* value = argv[arg + 1];
+        bool ok = true;
+        switch (argv[arg][1]) {
+        case 's':
+            options.seed = strtoull(value, nullptr, 10);
+            break;
+        case 'w': {
+            int speed;
+            ok = sscanf(value, "%d,%d,%d", &options.windX, &options.windY, &speed) == 3 && speed >= 0 && speed < WIND_LAST;
+            options.speed = (WindSpeed)speed;
+            break;
+        }
+        case 'p':
+            options.patch_size = strtof(value, nullptr);
+            break;
+        case 'm':
+            ok = sscanf(value, "%d,%d", &options.dry_moisture, &options.wet_moisture) == 2;
+            break;
+        case 'r':
+            options.num_rivers = (size_t)strtoul(value, nullptr, 10);
+            break;
+        case 'b':
+            options.num_firebreaks = (size_t)strtoul(value, nullptr, 10);
+            break;
+        case 'i':
+            ok = options.num_ignitions < MAX_IGNITIONS
+                 && sscanf(value, "%zu,%zu", &ignitions[options.num_ignitions].row, &ignitions[options.num_ignitions].col) == 2;
+            options.num_ignitions++;
+            break;
+        case 'n':
+            options.random_ignitions = (size_t)strtoul(value, nullptr, 10);
+            break;
+        case 'e':
+            options.cell_size = atoi(value);
+            ok = options.cell_size > 0;
+            break;
+        case 'f':
+            write_text = strcmp(value, "bin") != 0;
+            write_bin = strcmp(value, "text") != 0;
+            ok = strcmp(value, "text") == 0 || strcmp(value, "bin") == 0 || strcmp(value, "both") == 0;
+            break;
+        case 'j':
+            options.num_threads = (size_t)strtoul(value, nullptr, 10);
+            break;
+        default:
+            ok = false;
+        }
+
+        if (!ok || argv[arg][2] != '\0') {
+            fprintf(stderr, "ERROR: invalid option \"%s %s\"\n", argv[arg], value);
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - arg != 3) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    options.width = (size_t)strtoull(argv[arg], nullptr, 10);
+    options.height = (size_t)strtoull(argv[arg + 1], nullptr, 10);
+
+    char cellgrid_path[4096];
+    char cellbin_path[4096];
+    snprintf(cellgrid_path, sizeof(cellgrid_path), "%s.cellgrid", argv[arg + 2]);
+    snprintf(cellbin_path, sizeof(cellbin_path), "%s.cellbin", argv[arg + 2]);
+
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+
+    const bool ok = generateGrid(&options, write_text ? cellgrid_path : nullptr, write_bin ? cellbin_path : nullptr);
+
+    timespec_get(&end, TIME_UTC);
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (!ok)
+        return EXIT_FAILURE;
+
+    const double cells = (double)options.width * (double)options.height;
+    printf("%zux%zu cells in %.3f s (%.1f Mcells/s)\n", options.width, options.height, seconds, cells / seconds / 1e6);
+    return EXIT_SUCCESS;
+}
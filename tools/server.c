@@ -0,0 +1,39 @@
+// Keeps grids loaded and runs scenarios sent over a Unix domain socket, see scenario_server.h.
+// Usage: wildfire-server [-j workers] <socket> <grid.cellgrid>...
+#include "scenario_server.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t stop = 0;
+
+static void requestStop(int signal) {
+    (void)signal;
+    stop = 1;
+}
+
+int main(int argc, char const* const* argv) {
+    size_t workers = 0;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        workers = (size_t)strtoul(argv[2], nullptr, 10);
+        arg = 3;
+    }
+
+    if (argc - arg < 2) {
+        fprintf(stderr, "Usage: %s [-j workers] <socket> <grid.cellgrid>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    const ScenarioServerOptions options = {
+        .socket_path = argv[arg],
+        .grid_paths = argv + arg + 1,
+        .num_grids = (size_t)(argc - arg - 1),
+        .num_workers = workers,
+    };
+    return runScenarioServer(&options, &stop) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,52 @@
+// Runs every wind speed in every direction on one grid and prints the burnt area of each, see sweep.h.
+// Usage: wildfire-sweep [-j threads] <grid.cellgrid> [spec]
+#include "sweep.h"
+#include "wildfire.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int main(int argc, char const* const* argv) {
+    size_t threads = 0;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        threads = (size_t)strtoul(argv[2], nullptr, 10);
+        arg = 3;
+    }
+
+    if (argc - arg < 1 || argc - arg > 2) {
+        fprintf(stderr, "Usage: %s [-j threads] <grid.cellgrid> [spec]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    SweepSpec spec = defaultSweepSpec(30, 100, 1);
+    if (argc - arg == 2) {
+        destroySweepSpec(&spec);
+        if (!readSweepSpec(argv[arg + 1], &spec))
+            return EXIT_FAILURE;
+    }
+
+    WildfireContext* context = wildfireCreate(argv[arg], nullptr);
+    if (!context) {
+        destroySweepSpec(&spec);
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+
+    SweepSummary* summaries = runSweep(context, &spec, threads);
+
+    timespec_get(&end, TIME_UTC);
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    const WildfireView view = wildfireState(context);
+    printSweepSummary(&spec, summaries, view.num_rows * view.num_columns, stdout);
+    printf("%zu runs in %.3f s\n", spec.num_scenarios * spec.realizations, seconds);
+
+    free(summaries);
+    wildfireDestroy(context);
+    destroySweepSpec(&spec);
+    return EXIT_SUCCESS;
+}